@@ -0,0 +1,582 @@
+#define _GNU_SOURCE           // For ptrace options, nftw and wait4
+#include <stdio.h>            // For printf, fprintf, fopen
+#include <stdarg.h>           // For va_list
+#include <stdlib.h>           // For EXIT_SUCCESS, EXIT_FAILURE, mkdtemp
+#include <string.h>           // For strcmp, strstr, strerror
+#include <errno.h>            // For errno
+#include <limits.h>           // For PATH_MAX
+#include <fcntl.h>            // For open
+#include <ftw.h>              // For nftw, to remove the trees again
+#include <signal.h>           // For raise, SIGSTOP
+#include <time.h>             // For clock_gettime
+#include <unistd.h>           // For fork, execv, getopt
+#include <sys/ptrace.h>       // For counting system calls
+#include <sys/resource.h>     // For struct rusage
+#include <sys/stat.h>         // For mkdir, chmod
+#include <sys/wait.h>         // For wait4, waitpid
+
+#define MAX_ARGS 32
+
+// A generated tree: its name and the function that fills it in.
+// Generators return the number of entries created, or -1.
+struct shape
+{
+    const char *name;
+    long (*generate)(const char *root, int scale);
+};
+
+// A way of running pfind. "@DIR" is replaced by the tree, "@INDEX" by an
+// index file next to it. Modes run in order, so an index is built before
+// it is queried; only the warm-up run builds it from scratch, the timed
+// runs measure an incremental refresh.
+struct mode
+{
+    const char *name;
+    const char *args;
+};
+
+static const struct mode modes[] = {
+    {"default", "-d @DIR -p rw-r--r--"},
+    {"count", "-d @DIR -p rw-r--r-- --count"},
+    {"stats", "-d @DIR -p rw-r--r-- --count --stats"},
+    {"nul", "-d @DIR -p rw-r--r-- -0"},
+    {"follow", "-d @DIR -p rw-r--r-- -L"},
+    {"xdev", "-d @DIR -p rw-r--r-- -xdev"},
+    {"dedup-links", "-d @DIR -p rw-r--r-- --dedup-links"},
+    {"maxdepth2", "-d @DIR -p rw-r--r-- -maxdepth 2"},
+    {"inode-order", "-d @DIR -p rw-r--r-- --order=inode"},
+    {"bfs", "-d @DIR -p rw-r--r-- --bfs"},
+    {"max-open2", "-d @DIR -p rw-r--r-- --max-open 2"},
+    {"contains", "-d @DIR -p rw-r--r-- -contains x"},
+    {"duplicates", "-d @DIR --duplicates"},
+    {"prune", "-d @DIR -p rw-r--r-- -prune d1 -prune 'x*'"},
+    {"index-refresh", "-d @DIR --index @INDEX"},
+    {"index-query", "--use-index @INDEX -p rw-r--r--"},
+};
+
+// One measured run
+struct result
+{
+    double seconds;   // Best wall time over the repetitions
+    long max_rss_kb;  // Peak resident set size of that run
+    long syscalls;    // From a separate traced run, -1 if tracing failed
+    int exit_status;
+};
+
+// snprintf into a PATH_MAX buffer; fails instead of truncating
+static int make_path(char *out, const char *format, ...)
+{
+    va_list ap;
+    va_start(ap, format);
+    int n = vsnprintf(out, PATH_MAX, format, ap);
+    va_end(ap);
+    if (n < 0 || n >= PATH_MAX)
+    {
+        fprintf(stderr, "Error: Path too long.\n");
+        return -1;
+    }
+    return 0;
+}
+
+static int make_dir(const char *path)
+{
+    if (mkdir(path, 0755) < 0 && errno != EEXIST)
+    {
+        fprintf(stderr, "Error: Cannot create directory '%s'. %s.\n", path, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+static int make_file(const char *path, mode_t mode)
+{
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    if (fd < 0)
+    {
+        fprintf(stderr, "Error: Cannot create file '%s'. %s.\n", path, strerror(errno));
+        return -1;
+    }
+    close(fd);
+    return chmod(path, mode); // Not subject to the umask, unlike open()
+}
+
+// Creates files f0..f(n-1) in dir, cycling through modes
+static long make_files(const char *dir, long n, const mode_t *file_modes, size_t nmodes)
+{
+    char path[PATH_MAX];
+    for (long i = 0; i < n; i++)
+    {
+        if (make_path(path, "%s/f%ld", dir, i) < 0 || make_file(path, file_modes[(size_t)i % nmodes]) < 0)
+        {
+            return -1;
+        }
+    }
+    return n;
+}
+
+static const mode_t plain[] = {0644};
+static const mode_t mixed[] = {0644, 0600, 0755, 0666, 0640, 0444, 0700, 0000};
+
+// 200 directories of 250 files
+static long gen_wide(const char *root, int scale)
+{
+    char dir[PATH_MAX];
+    long entries = 0;
+    for (int d = 0; d < 200 * scale; d++)
+    {
+        if (make_path(dir, "%s/d%d", root, d) < 0 || make_dir(dir) < 0 || make_files(dir, 250, plain, 1) < 0)
+        {
+            return -1;
+        }
+        entries += 251;
+    }
+    return entries;
+}
+
+// A chain of 1000 nested directories (close to PATH_MAX) with files on every level
+static long gen_deep(const char *root, int scale)
+{
+    char dir[PATH_MAX];
+    if (make_path(dir, "%s", root) < 0)
+    {
+        return -1;
+    }
+    long entries = 0;
+    for (int depth = 0; depth < 1000; depth++)
+    {
+        size_t len = strlen(dir);
+        snprintf(dir + len, PATH_MAX - len, "/d");
+        if (make_dir(dir) < 0 || make_files(dir, 25L * scale, plain, 1) < 0)
+        {
+            return -1;
+        }
+        entries += 1 + 25L * scale;
+    }
+    return entries;
+}
+
+// 20000 directories over two levels holding a single file each
+static long gen_tinydirs(const char *root, int scale)
+{
+    char dir[PATH_MAX];
+    long entries = 0;
+    for (int a = 0; a < 100 * scale; a++)
+    {
+        if (make_path(dir, "%s/d%d", root, a) < 0 || make_dir(dir) < 0)
+        {
+            return -1;
+        }
+        entries++;
+        for (int b = 0; b < 200; b++)
+        {
+            if (make_path(dir, "%s/d%d/x%d", root, a, b) < 0 || make_dir(dir) < 0 ||
+                make_files(dir, 1, plain, 1) < 0)
+            {
+                return -1;
+            }
+            entries += 2;
+        }
+    }
+    return entries;
+}
+
+// One directory with 50000 files
+static long gen_flat(const char *root, int scale)
+{
+    return make_files(root, 50000L * scale, plain, 1);
+}
+
+// 100 directories of 500 files with eight different permissions
+static long gen_mixed(const char *root, int scale)
+{
+    char dir[PATH_MAX];
+    long entries = 0;
+    for (int d = 0; d < 100 * scale; d++)
+    {
+        if (make_path(dir, "%s/d%d", root, d) < 0 || make_dir(dir) < 0 ||
+            make_files(dir, 500, mixed, sizeof(mixed) / sizeof(mixed[0])) < 0)
+        {
+            return -1;
+        }
+        entries += 501;
+    }
+    return entries;
+}
+
+// 100 directories of 200 files, each with a symlink cycle to the root, a
+// link to its neighbour and hard links to its first ten files
+static long gen_symlinks(const char *root, int scale)
+{
+    char dir[PATH_MAX], path[PATH_MAX], target[PATH_MAX];
+    long entries = 0;
+    for (int d = 0; d < 100 * scale; d++)
+    {
+        if (make_path(dir, "%s/d%d", root, d) < 0 || make_dir(dir) < 0 || make_files(dir, 200, plain, 1) < 0)
+        {
+            return -1;
+        }
+        int rc = make_path(path, "%s/up", dir) < 0 || symlink("..", path) < 0 ? -1 : 0;
+        if (rc == 0 && (make_path(path, "%s/next", dir) < 0 ||
+                        make_path(target, "../d%d", (d + 1) % (100 * scale)) < 0 || symlink(target, path) < 0))
+        {
+            rc = -1;
+        }
+        for (int i = 0; i < 10 && rc == 0; i++)
+        {
+            if (make_path(target, "%s/f%d", dir, i) < 0 || make_path(path, "%s/h%d", dir, i) < 0 ||
+                link(target, path) < 0)
+            {
+                rc = -1;
+            }
+        }
+        if (rc < 0)
+        {
+            fprintf(stderr, "Error: Cannot create links in '%s'. %s.\n", dir, strerror(errno));
+            return -1;
+        }
+        entries += 213;
+    }
+    return entries;
+}
+
+static const struct shape shapes[] = {
+    {"wide", gen_wide},
+    {"deep", gen_deep},
+    {"tinydirs", gen_tinydirs},
+    {"flat", gen_flat},
+    {"mixed", gen_mixed},
+    {"symlinks", gen_symlinks},
+};
+
+static int remove_entry(const char *path, const struct stat *st, int type, struct FTW *ftw)
+{
+    (void)st;
+    (void)ftw;
+    return type == FTW_DP ? rmdir(path) : unlink(path);
+}
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+// True if name is in the comma-separated list (an empty list selects all)
+static int selected(const char *list, const char *name)
+{
+    if (!list)
+    {
+        return 1;
+    }
+    size_t len = strlen(name);
+    for (const char *p = list; (p = strstr(p, name)) != NULL; p += len)
+    {
+        if ((p == list || p[-1] == ',') && (p[len] == ',' || p[len] == '\0'))
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Splits a mode's argument string into argv (in buffer), substituting
+// @DIR and @INDEX and dropping single quotes
+static int build_argv(char *argv[], char *buffer, size_t size, const char *pfind, const char *args,
+                      const char *dir, const char *index)
+{
+    int argc = 0;
+    size_t used = 0;
+    argv[argc++] = (char *)pfind;
+    for (const char *p = args; *p && argc < MAX_ARGS - 1;)
+    {
+        while (*p == ' ')
+        {
+            p++;
+        }
+        if (!*p)
+        {
+            break;
+        }
+        argv[argc++] = buffer + used;
+        while (*p && *p != ' ')
+        {
+            const char *sub = NULL;
+            if (strncmp(p, "@DIR", 4) == 0)
+            {
+                sub = dir;
+                p += 4;
+            }
+            else if (strncmp(p, "@INDEX", 6) == 0)
+            {
+                sub = index;
+                p += 6;
+            }
+            size_t n = sub ? strlen(sub) : (*p != '\'');
+            if (used + n + 1 >= size)
+            {
+                return -1;
+            }
+            memcpy(buffer + used, sub ? sub : p, n);
+            used += n;
+            if (!sub)
+            {
+                p++;
+            }
+        }
+        buffer[used++] = '\0';
+    }
+    argv[argc] = NULL;
+    return argc;
+}
+
+// Child side of every run: output goes to /dev/null, errors are kept quiet
+static void exec_pfind(char *argv[])
+{
+    int null_fd = open("/dev/null", O_WRONLY);
+    if (null_fd >= 0)
+    {
+        dup2(null_fd, STDOUT_FILENO);
+        dup2(null_fd, STDERR_FILENO);
+        close(null_fd);
+    }
+    execv(argv[0], argv);
+    _exit(127);
+}
+
+// Runs pfind once untraced; wall time from a monotonic clock, RSS from wait4
+static int timed_run(char *argv[], double *seconds, long *max_rss_kb, int *exit_status)
+{
+    double start = now();
+    pid_t pid = fork();
+    if (pid < 0)
+    {
+        fprintf(stderr, "Error: fork() failed. %s.\n", strerror(errno));
+        return -1;
+    }
+    if (pid == 0)
+    {
+        exec_pfind(argv);
+    }
+
+    int status;
+    struct rusage usage;
+    if (wait4(pid, &status, 0, &usage) < 0)
+    {
+        fprintf(stderr, "Error: wait4() failed. %s.\n", strerror(errno));
+        return -1;
+    }
+    *seconds = now() - start;
+    *max_rss_kb = usage.ru_maxrss;
+    *exit_status = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+    return 0;
+}
+
+// Runs pfind under ptrace and counts system calls across all its threads.
+// Tracing slows the run down a lot, so it is never the timed run.
+static long count_syscalls(char *argv[])
+{
+    pid_t pid = fork();
+    if (pid < 0)
+    {
+        return -1;
+    }
+    if (pid == 0)
+    {
+        if (ptrace(PTRACE_TRACEME, 0, NULL, NULL) < 0)
+        {
+            _exit(127);
+        }
+        raise(SIGSTOP); // Let the parent set options before exec
+        exec_pfind(argv);
+    }
+
+    int status;
+    if (waitpid(pid, &status, 0) < 0 || !WIFSTOPPED(status) ||
+        ptrace(PTRACE_SETOPTIONS, pid, NULL,
+               (void *)(long)(PTRACE_O_TRACESYSGOOD | PTRACE_O_TRACECLONE | PTRACE_O_EXITKILL)) < 0)
+    {
+        kill(pid, SIGKILL);
+        waitpid(pid, NULL, 0);
+        return -1;
+    }
+
+    long stops = 0;
+    ptrace(PTRACE_SYSCALL, pid, NULL, NULL);
+    pid_t tid;
+    while ((tid = waitpid(-1, &status, __WALL)) > 0)
+    {
+        if (!WIFSTOPPED(status))
+        {
+            continue; // A thread or the process exited
+        }
+        int sig = WSTOPSIG(status);
+        if (sig == (SIGTRAP | 0x80))
+        {
+            stops++;
+            sig = 0;
+        }
+        else if (sig == SIGTRAP || sig == SIGSTOP)
+        {
+            sig = 0; // exec, clone events and new threads starting up
+        }
+        ptrace(PTRACE_SYSCALL, tid, NULL, (void *)(long)sig);
+    }
+    return (stops + 1) / 2; // An entry and an exit stop per call (exit_group has no exit)
+}
+
+static void usage(void)
+{
+    printf("Usage: ./pfind_bench -p <pfind> [-r <work dir>] [-o <csv file>] [-n <scale>]\n"
+           "                     [-t <repetitions>] [-s <shape,...>] [-m <mode,...>] [-k] [-h]\n");
+}
+
+int main(int argc, char *argv[])
+{
+    const char *pfind = NULL, *work = NULL, *csv = "bench.csv";
+    const char *shape_list = NULL, *mode_list = NULL;
+    int scale = 1, repetitions = 3, keep = 0, opt;
+
+    while ((opt = getopt(argc, argv, "p:r:o:n:t:s:m:kh")) != -1)
+    {
+        switch (opt)
+        {
+        case 'p':
+            pfind = optarg;
+            break;
+        case 'r':
+            work = optarg;
+            break;
+        case 'o':
+            csv = optarg;
+            break;
+        case 'n':
+            scale = atoi(optarg);
+            break;
+        case 't':
+            repetitions = atoi(optarg);
+            break;
+        case 's':
+            shape_list = optarg;
+            break;
+        case 'm':
+            mode_list = optarg;
+            break;
+        case 'k':
+            keep = 1;
+            break;
+        case 'h':
+            usage();
+            return EXIT_SUCCESS;
+        default:
+            usage();
+            return EXIT_FAILURE;
+        }
+    }
+    if (!pfind || scale < 1 || repetitions < 1)
+    {
+        usage();
+        return EXIT_FAILURE;
+    }
+
+    // Prefer tmpfs so the numbers measure pfind, not the disk
+    char root[PATH_MAX];
+    struct stat st;
+    const char *base = work ? work : (stat("/dev/shm", &st) == 0 ? "/dev/shm" : "/tmp");
+    if (make_path(root, "%s/pfind-bench-XXXXXX", base) < 0 || !mkdtemp(root))
+    {
+        fprintf(stderr, "Error: Cannot create work directory in '%s'. %s.\n", base, strerror(errno));
+        return EXIT_FAILURE;
+    }
+
+    int write_header = stat(csv, &st) < 0;
+    FILE *out = fopen(csv, "a");
+    if (!out)
+    {
+        fprintf(stderr, "Error: Cannot open '%s'. %s.\n", csv, strerror(errno));
+        nftw(root, remove_entry, 64, FTW_DEPTH | FTW_PHYS);
+        return EXIT_FAILURE;
+    }
+    if (write_header)
+    {
+        fprintf(out, "timestamp,shape,mode,entries,seconds,entries_per_sec,syscalls,syscalls_per_entry,"
+                     "max_rss_kb,exit_status\n");
+    }
+    long timestamp = (long)time(NULL);
+
+    printf("%-10s %-12s %9s %10s %14s %12s %10s\n", "shape", "mode", "entries", "seconds", "entries/sec",
+           "syscalls/ent", "rss_kb");
+
+    int rc = EXIT_SUCCESS;
+    for (size_t s = 0; s < sizeof(shapes) / sizeof(shapes[0]) && rc == EXIT_SUCCESS; s++)
+    {
+        if (!selected(shape_list, shapes[s].name))
+        {
+            continue;
+        }
+
+        char dir[PATH_MAX], index[PATH_MAX];
+        long entries;
+        if (make_path(dir, "%s/%s", root, shapes[s].name) < 0 ||
+            make_path(index, "%s/%s.idx", root, shapes[s].name) < 0 || make_dir(dir) < 0 || (entries = shapes[s].generate(dir, scale)) < 0)
+        {
+            rc = EXIT_FAILURE;
+            break;
+        }
+
+        for (size_t m = 0; m < sizeof(modes) / sizeof(modes[0]); m++)
+        {
+            if (!selected(mode_list, modes[m].name))
+            {
+                continue;
+            }
+
+            char *run_argv[MAX_ARGS], buffer[4 * PATH_MAX];
+            if (build_argv(run_argv, buffer, sizeof(buffer), pfind, modes[m].args, dir, index) < 0)
+            {
+                fprintf(stderr, "Error: Arguments too long for mode '%s'.\n", modes[m].name);
+                rc = EXIT_FAILURE;
+                break;
+            }
+
+            // One warm-up run so every repetition sees a hot cache
+            struct result r = {.seconds = -1};
+            double seconds;
+            long rss;
+            int status;
+            for (int i = 0; i <= repetitions; i++)
+            {
+                if (timed_run(run_argv, &seconds, &rss, &status) < 0)
+                {
+                    rc = EXIT_FAILURE;
+                    break;
+                }
+                if (i > 0 && (r.seconds < 0 || seconds < r.seconds))
+                {
+                    r.seconds = seconds;
+                    r.max_rss_kb = rss;
+                    r.exit_status = status;
+                }
+            }
+            if (rc != EXIT_SUCCESS)
+            {
+                break;
+            }
+            r.syscalls = count_syscalls(run_argv);
+
+            double rate = r.seconds > 0 ? (double)entries / r.seconds : 0;
+            double per_entry = r.syscalls >= 0 ? (double)r.syscalls / (double)entries : -1;
+            printf("%-10s %-12s %9ld %10.4f %14.0f %12.3f %10ld%s\n", shapes[s].name, modes[m].name, entries,
+                   r.seconds, rate, per_entry, r.max_rss_kb, r.exit_status ? "  (non-zero exit)" : "");
+            fprintf(out, "%ld,%s,%s,%ld,%.6f,%.0f,%ld,%.4f,%ld,%d\n", timestamp, shapes[s].name, modes[m].name,
+                    entries, r.seconds, rate, r.syscalls, per_entry, r.max_rss_kb, r.exit_status);
+        }
+    }
+
+    fclose(out);
+    if (!keep)
+    {
+        nftw(root, remove_entry, 64, FTW_DEPTH | FTW_PHYS);
+    }
+    return rc;
+}
@@ -0,0 +1,226 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>   // For fprintf
+#include <stdlib.h>  // For malloc, free
+#include <string.h>  // For memchr, memcmp, strerror
+#include <errno.h>   // For errno
+#include <fcntl.h>   // For open
+#include <unistd.h>  // For read, close
+#include <pthread.h> // For the worker threads
+#include "contains.h"
+#include "out.h"
+
+#define CONTAINS_QUEUE 1024               // Paths waiting for a worker
+#define CONTAINS_BLOCK (1024 * 1024)      // Bytes read from a file at a time
+
+struct contains_pool
+{
+    const char *pattern;
+    size_t pattern_len;
+    pthread_t *threads;
+    int nthreads;
+
+    pthread_mutex_t lock;      // Guards the queue and done
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+    char *queue[CONTAINS_QUEUE]; // Ring buffer of owned paths
+    size_t head, count;
+    int done;                  // No more paths will be submitted
+
+    pthread_mutex_t out_lock;  // out_path() is not thread-safe; also guards matches
+    unsigned long long matches; // Files found to contain the pattern
+    int failed;                // A worker could not allocate its buffer
+};
+
+// First occurrence of pattern in the n bytes at data, or NULL. memchr()
+// (vectorised in libc) skips to each candidate first byte, so most of the
+// data is never compared byte by byte.
+static const char *find(const char *data, size_t n, const char *pattern, size_t m)
+{
+    if (m == 0)
+    {
+        return data;
+    }
+    const char *end = data + n;
+    const char *p = data;
+    while ((size_t)(end - p) >= m && (p = memchr(p, pattern[0], (size_t)(end - p) - m + 1)) != NULL)
+    {
+        if (memcmp(p + 1, pattern + 1, m - 1) == 0)
+        {
+            return p;
+        }
+        p++;
+    }
+    return NULL;
+}
+
+// Reads path in CONTAINS_BLOCK blocks, keeping the last pattern_len - 1
+// bytes of each block in front of the next so a match across a block
+// boundary is found. Returns 1 if it contains the pattern, 0 if not.
+static int file_contains(struct contains_pool *pool, const char *path, char *buffer)
+{
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        fprintf(stderr, "Error: Cannot open '%s'. %s.\n", path, strerror(errno));
+        return 0;
+    }
+
+    size_t m = pool->pattern_len;
+    size_t kept = 0; // Bytes carried over from the previous block
+    int found = m == 0;
+    while (!found)
+    {
+        ssize_t n = read(fd, buffer + kept, CONTAINS_BLOCK);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            fprintf(stderr, "Error: Cannot read '%s'. %s.\n", path, strerror(errno));
+            break;
+        }
+        if (n == 0)
+        {
+            break;
+        }
+        size_t have = kept + (size_t)n;
+        found = find(buffer, have, pool->pattern, m) != NULL;
+        kept = have < m - 1 ? have : m - 1;
+        memmove(buffer, buffer + have - kept, kept);
+    }
+    close(fd);
+    return found;
+}
+
+static void *worker(void *arg)
+{
+    struct contains_pool *pool = arg;
+    // Room for a block plus the carried-over tail of the previous one
+    char *buffer = malloc(CONTAINS_BLOCK + pool->pattern_len);
+    if (!buffer)
+    {
+        fprintf(stderr, "Error: malloc() failed. %s.\n", strerror(errno));
+    }
+
+    for (;;)
+    {
+        pthread_mutex_lock(&pool->lock);
+        while (pool->count == 0 && !pool->done)
+        {
+            pthread_cond_wait(&pool->not_empty, &pool->lock);
+        }
+        if (pool->count == 0)
+        {
+            pthread_mutex_unlock(&pool->lock);
+            break;
+        }
+        char *path = pool->queue[pool->head];
+        pool->head = (pool->head + 1) % CONTAINS_QUEUE;
+        pool->count--;
+        if (!buffer)
+        {
+            pool->failed = 1;
+        }
+        pthread_cond_signal(&pool->not_full);
+        pthread_mutex_unlock(&pool->lock);
+
+        if (buffer && file_contains(pool, path, buffer))
+        {
+            pthread_mutex_lock(&pool->out_lock);
+            out_path(path, strlen(path));
+            pool->matches++;
+            pthread_mutex_unlock(&pool->out_lock);
+        }
+        free(path);
+    }
+
+    free(buffer);
+    return NULL;
+}
+
+struct contains_pool *contains_start(const char *pattern, int workers)
+{
+    struct contains_pool *pool = calloc(1, sizeof(*pool));
+    if (!pool)
+    {
+        fprintf(stderr, "Error: calloc() failed. %s.\n", strerror(errno));
+        return NULL;
+    }
+    pool->pattern = pattern;
+    pool->pattern_len = strlen(pattern);
+    pool->threads = malloc((size_t)workers * sizeof(*pool->threads));
+    if (!pool->threads)
+    {
+        fprintf(stderr, "Error: malloc() failed. %s.\n", strerror(errno));
+        free(pool);
+        return NULL;
+    }
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_mutex_init(&pool->out_lock, NULL);
+    pthread_cond_init(&pool->not_empty, NULL);
+    pthread_cond_init(&pool->not_full, NULL);
+
+    for (; pool->nthreads < workers; pool->nthreads++)
+    {
+        int err = pthread_create(&pool->threads[pool->nthreads], NULL, worker, pool);
+        if (err)
+        {
+            fprintf(stderr, "Error: pthread_create() failed. %s.\n", strerror(err));
+            if (pool->nthreads == 0)
+            {
+                contains_finish(pool, NULL);
+                return NULL;
+            }
+            break; // Carry on with the workers that did start
+        }
+    }
+    return pool;
+}
+
+int contains_submit(struct contains_pool *pool, const char *path, size_t len)
+{
+    char *copy = malloc(len + 1);
+    if (!copy)
+    {
+        fprintf(stderr, "Error: malloc() failed. %s.\n", strerror(errno));
+        return -1;
+    }
+    memcpy(copy, path, len + 1);
+
+    pthread_mutex_lock(&pool->lock);
+    while (pool->count == CONTAINS_QUEUE)
+    {
+        pthread_cond_wait(&pool->not_full, &pool->lock);
+    }
+    pool->queue[(pool->head + pool->count) % CONTAINS_QUEUE] = copy;
+    pool->count++;
+    pthread_cond_signal(&pool->not_empty);
+    pthread_mutex_unlock(&pool->lock);
+    return 0;
+}
+
+int contains_finish(struct contains_pool *pool, unsigned long long *matches)
+{
+    pthread_mutex_lock(&pool->lock);
+    pool->done = 1;
+    pthread_cond_broadcast(&pool->not_empty);
+    pthread_mutex_unlock(&pool->lock);
+    for (int i = 0; i < pool->nthreads; i++)
+    {
+        pthread_join(pool->threads[i], NULL);
+    }
+
+    int rc = pool->failed ? -1 : 0;
+    if (matches)
+    {
+        *matches = pool->matches;
+    }
+    pthread_mutex_destroy(&pool->lock);
+    pthread_mutex_destroy(&pool->out_lock);
+    pthread_cond_destroy(&pool->not_empty);
+    pthread_cond_destroy(&pool->not_full);
+    free(pool->threads);
+    free(pool);
+    return rc;
+}
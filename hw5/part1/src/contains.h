@@ -0,0 +1,26 @@
+#ifndef CONTAINS_H
+#define CONTAINS_H
+
+#include <stddef.h> // For size_t
+
+// -contains: a pool of worker threads that reads candidate files and
+// reports (with out_path()) those containing a byte string. The walk
+// hands over files that already passed every cheaper predicate, so only
+// those are ever opened, and reading overlaps with the traversal.
+// Matches are reported in the order the workers finish, not walk order.
+struct contains_pool;
+
+// Starts workers threads searching for pattern (which must outlive the
+// pool). Returns NULL on failure (an error has been printed).
+struct contains_pool *contains_start(const char *pattern, int workers);
+
+// Queues path for a worker, waiting while the queue is full.
+// Returns 0, or -1 on allocation failure (an error has been printed).
+int contains_submit(struct contains_pool *pool, const char *path, size_t len);
+
+// Waits for every queued file to be searched, then stops the workers and
+// frees the pool. Stores the number of files reported in *matches unless
+// matches is NULL. Returns 0, or -1 if the pool failed.
+int contains_finish(struct contains_pool *pool, unsigned long long *matches);
+
+#endif
@@ -0,0 +1,513 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>   // For fprintf
+#include <stdlib.h>  // For malloc, realloc, qsort
+#include <stdint.h>  // For uint64_t, SIZE_MAX
+#include <string.h>  // For memcpy, memcmp, strcmp, strerror
+#include <errno.h>   // For errno
+#include <fcntl.h>   // For open, posix_fadvise
+#include <unistd.h>  // For pread, close
+#include <pthread.h> // For the hashing threads
+#include "dups.h"
+#include "out.h"
+
+#define DUPS_BLOCK (1024 * 1024) // Bytes read at a time when hashing or comparing a whole file
+
+// What a stage does with each of its files
+enum pass
+{
+    PASS_SAMPLE, // Hash the head and tail
+    PASS_FULL,   // Hash the whole file
+    PASS_VERIFY  // Compare the whole file with the file it is grouped with
+};
+
+static const char *path_of(const struct dups *dups, const struct dup_file *file)
+{
+    return dups->paths + file->path;
+}
+
+void dups_init(struct dups *dups)
+{
+    memset(dups, 0, sizeof(*dups));
+}
+
+void dups_free(struct dups *dups)
+{
+    free(dups->files);
+    free(dups->paths);
+    dups_init(dups);
+}
+
+int dups_add(struct dups *dups, const char *path, size_t len, off_t size)
+{
+    if (dups->count == dups->cap)
+    {
+        size_t cap = dups->cap ? dups->cap * 2 : 1024;
+        struct dup_file *files = realloc(dups->files, cap * sizeof(*files));
+        if (!files)
+        {
+            fprintf(stderr, "Error: realloc() failed. %s.\n", strerror(errno));
+            return -1;
+        }
+        dups->files = files;
+        dups->cap = cap;
+    }
+    if (dups->used + len + 1 > dups->paths_cap)
+    {
+        size_t cap = dups->paths_cap ? dups->paths_cap : 64 * 1024;
+        while (dups->used + len + 1 > cap)
+        {
+            cap *= 2;
+        }
+        char *paths = realloc(dups->paths, cap);
+        if (!paths)
+        {
+            fprintf(stderr, "Error: realloc() failed. %s.\n", strerror(errno));
+            return -1;
+        }
+        dups->paths = paths;
+        dups->paths_cap = cap;
+    }
+
+    struct dup_file *file = &dups->files[dups->count++];
+    memset(file, 0, sizeof(*file));
+    file->path = dups->used;
+    file->size = size;
+    memcpy(dups->paths + dups->used, path, len + 1);
+    dups->used += len + 1;
+    return 0;
+}
+
+// 128-bit content hash: two 64-bit multiply-rotate lanes over 8-byte
+// words. Not cryptographic, but collisions between different files are
+// vanishingly unlikely at 128 bits.
+static uint64_t rotl(uint64_t x, int r)
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+static void hash_bytes(unsigned long long h[2], const unsigned char *data, size_t n)
+{
+    uint64_t a = h[0], b = h[1];
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+        uint64_t word;
+        memcpy(&word, data + i, 8);
+        a = rotl(a ^ (word * 0x9e3779b97f4a7c15ULL), 31) * 0xbf58476d1ce4e5b9ULL;
+        b = rotl(b + word, 27) * 0x94d049bb133111ebULL + a;
+    }
+    if (i < n)
+    {
+        uint64_t word = 0;
+        memcpy(&word, data + i, n - i);
+        a = rotl(a ^ (word * 0x9e3779b97f4a7c15ULL) ^ (n - i), 31) * 0xbf58476d1ce4e5b9ULL;
+        b = rotl(b + word, 27) * 0x94d049bb133111ebULL + a;
+    }
+    h[0] = a;
+    h[1] = b;
+}
+
+// Reads length bytes at offset into buffer. Returns 0, or -1 on error or
+// if the file got shorter.
+static int read_at(int fd, char *buffer, size_t length, off_t offset)
+{
+    size_t done = 0;
+    while (done < length)
+    {
+        ssize_t n = pread(fd, buffer + done, length - done, offset + (off_t)done);
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            if (n == 0)
+            {
+                errno = 0; // Not an I/O error: the file was truncated
+            }
+            return -1;
+        }
+        done += (size_t)n;
+    }
+    return 0;
+}
+
+// Hashes the head and tail of file (all of it if it is small enough), or
+// the whole file in DUPS_BLOCK reads
+static void hash_file(const struct dups *dups, struct dup_file *file, char *buffer, enum pass pass)
+{
+    int full = pass == PASS_FULL;
+    const char *path = path_of(dups, file);
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        fprintf(stderr, "Error: Cannot open '%s'. %s.\n", path, strerror(errno));
+        file->failed = 1;
+        return;
+    }
+
+    unsigned long long *h = full ? file->full : file->sample;
+    h[0] = (unsigned long long)file->size;
+    h[1] = ~(unsigned long long)file->size;
+    size_t size = (size_t)file->size;
+    int rc = 0;
+    if (!full)
+    {
+        // A file of at most two samples is read whole, so this is exact
+        size_t head = size < DUPS_SAMPLE ? size : DUPS_SAMPLE;
+        size_t tail = size - head < DUPS_SAMPLE ? size - head : DUPS_SAMPLE;
+        rc = read_at(fd, buffer, head, 0);
+        if (rc == 0 && tail)
+        {
+            rc = read_at(fd, buffer + head, tail, file->size - (off_t)tail);
+        }
+        if (rc == 0)
+        {
+            hash_bytes(h, (const unsigned char *)buffer, head + tail);
+        }
+    }
+    else
+    {
+        posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+        for (size_t offset = 0; offset < size && rc == 0; offset += DUPS_BLOCK)
+        {
+            size_t length = size - offset < DUPS_BLOCK ? size - offset : DUPS_BLOCK;
+            rc = read_at(fd, buffer, length, (off_t)offset);
+            if (rc == 0)
+            {
+                hash_bytes(h, (const unsigned char *)buffer, length);
+            }
+        }
+    }
+    if (rc < 0)
+    {
+        fprintf(stderr, "Error: Cannot read '%s'. %s.\n", path, errno ? strerror(errno) : "File got shorter");
+        file->failed = 1;
+    }
+    close(fd);
+}
+
+// Compares file byte for byte with the file it was grouped with
+// (file->same_as), DUPS_BLOCK at a time; the hashes only say they are
+// probably identical. Sets verified if they are, or same_as to SIZE_MAX
+// if not, so a later round can group the file with another one. A file
+// that cannot be read is reported and marked failed; if it is the other
+// file, only ref_error is set, for verify_groups() to report it once.
+static void verify_file(const struct dups *dups, struct dup_file *file, char *buffer)
+{
+    const struct dup_file *other = &dups->files[file->same_as];
+    int fd = open(path_of(dups, file), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        fprintf(stderr, "Error: Cannot open '%s'. %s.\n", path_of(dups, file), strerror(errno));
+        file->failed = 1;
+        return;
+    }
+    int other_fd = open(path_of(dups, other), O_RDONLY | O_CLOEXEC);
+    if (other_fd < 0)
+    {
+        file->ref_error = errno;
+        close(fd);
+        return;
+    }
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    posix_fadvise(other_fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    size_t size = (size_t)file->size;
+    int same = 1;
+    for (size_t offset = 0; offset < size && same; offset += DUPS_BLOCK)
+    {
+        size_t length = size - offset < DUPS_BLOCK ? size - offset : DUPS_BLOCK;
+        if (read_at(fd, buffer, length, (off_t)offset) < 0)
+        {
+            fprintf(stderr, "Error: Cannot read '%s'. %s.\n", path_of(dups, file), errno ? strerror(errno) : "File got shorter");
+            file->failed = 1;
+            break;
+        }
+        if (read_at(other_fd, buffer + DUPS_BLOCK, length, (off_t)offset) < 0)
+        {
+            file->ref_error = errno ? errno : -1;
+            break;
+        }
+        same = memcmp(buffer, buffer + DUPS_BLOCK, length) == 0;
+    }
+    close(fd);
+    close(other_fd);
+
+    if (file->failed || file->ref_error)
+    {
+        return;
+    }
+    if (same)
+    {
+        file->verified = 1;
+    }
+    else
+    {
+        file->same_as = SIZE_MAX; // A hash collision
+    }
+}
+
+// Files to hash or verify in one stage, shared by the worker threads
+struct stage
+{
+    struct dups *dups;
+    size_t *todo; // Indexes into dups->files
+    size_t n;
+    size_t next;  // Next todo entry to hand out
+    enum pass pass;
+    pthread_mutex_t lock;
+};
+
+static void *hash_worker(void *arg)
+{
+    struct stage *stage = arg;
+    char *buffer = malloc(stage->pass == PASS_SAMPLE ? 2 * DUPS_SAMPLE
+                          : stage->pass == PASS_FULL ? DUPS_BLOCK
+                                                     : 2 * DUPS_BLOCK);
+    if (!buffer)
+    {
+        fprintf(stderr, "Error: malloc() failed. %s.\n", strerror(errno));
+    }
+    for (;;)
+    {
+        pthread_mutex_lock(&stage->lock);
+        size_t i = stage->next++;
+        pthread_mutex_unlock(&stage->lock);
+        if (i >= stage->n)
+        {
+            break;
+        }
+        struct dup_file *file = &stage->dups->files[stage->todo[i]];
+        if (buffer && stage->pass == PASS_VERIFY)
+        {
+            verify_file(stage->dups, file, buffer);
+        }
+        else if (buffer)
+        {
+            hash_file(stage->dups, file, buffer, stage->pass);
+        }
+        else
+        {
+            file->failed = 1;
+        }
+    }
+    free(buffer);
+    return NULL;
+}
+
+// Hashes or verifies every todo file on up to workers threads (the calling one included)
+static void run_stage(struct dups *dups, size_t *todo, size_t n, enum pass pass, int workers)
+{
+    struct stage stage = {.dups = dups, .todo = todo, .n = n, .pass = pass};
+    pthread_mutex_init(&stage.lock, NULL);
+    pthread_t *threads = malloc((size_t)workers * sizeof(*threads));
+    int started = 0;
+    while (threads && started < workers - 1 && (size_t)started + 1 < n &&
+           pthread_create(&threads[started], NULL, hash_worker, &stage) == 0)
+    {
+        started++;
+    }
+    hash_worker(&stage);
+    for (int i = 0; i < started; i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+    free(threads);
+    pthread_mutex_destroy(&stage.lock);
+}
+
+// Sort order: unreadable files last, then largest first, then by the hashes so far, then by path.
+// The hashes are zero until computed, so earlier stages sort the same way.
+static const struct dups *sorting;
+
+static int compare_files(const void *a, const void *b)
+{
+    const struct dup_file *fa = a, *fb = b;
+    if (fa->failed != fb->failed)
+    {
+        return fa->failed - fb->failed;
+    }
+    if (fa->size != fb->size)
+    {
+        return fa->size > fb->size ? -1 : 1;
+    }
+    for (int i = 0; i < 2; i++)
+    {
+        if (fa->sample[i] != fb->sample[i])
+        {
+            return fa->sample[i] < fb->sample[i] ? -1 : 1;
+        }
+    }
+    for (int i = 0; i < 2; i++)
+    {
+        if (fa->full[i] != fb->full[i])
+        {
+            return fa->full[i] < fb->full[i] ? -1 : 1;
+        }
+    }
+    return strcmp(path_of(sorting, fa), path_of(sorting, fb));
+}
+
+// True if a and b could still be identical after the hashing done so far
+static int same_so_far(const struct dup_file *a, const struct dup_file *b)
+{
+    return !a->failed && !b->failed && a->size == b->size && a->sample[0] == b->sample[0] &&
+           a->sample[1] == b->sample[1] && a->full[0] == b->full[0] && a->full[1] == b->full[1];
+}
+
+// Sorts the files, then collects every one that shares its group with
+// another file (and, for the full stage, is bigger than two samples)
+static size_t collect_collisions(struct dups *dups, size_t *todo, int full)
+{
+    sorting = dups;
+    qsort(dups->files, dups->count, sizeof(*dups->files), compare_files);
+    size_t n = 0;
+    for (size_t i = 0; i < dups->count;)
+    {
+        size_t end = i + 1;
+        while (end < dups->count && same_so_far(&dups->files[i], &dups->files[end]))
+        {
+            end++;
+        }
+        if (end - i > 1 && !dups->files[i].failed && (!full || dups->files[i].size > 2 * DUPS_SAMPLE))
+        {
+            for (; i < end; i++)
+            {
+                todo[n++] = i;
+            }
+        }
+        i = end;
+    }
+    return n;
+}
+
+// End of the group of files starting at i that the hashes cannot tell apart
+static size_t group_end(const struct dups *dups, size_t i)
+{
+    size_t end = i + 1;
+    while (end < dups->count && same_so_far(&dups->files[i], &dups->files[end]))
+    {
+        end++;
+    }
+    return end;
+}
+
+// Compares every file of each group with a first file, in rounds: files
+// that turn out to differ (a hash collision), or whose first file could
+// not be read, are compared with each other in the next round, until no
+// group has two unmatched files left.
+static void verify_groups(struct dups *dups, size_t *todo, int workers)
+{
+    for (size_t i = 0; i < dups->count; i++)
+    {
+        dups->files[i].same_as = SIZE_MAX;
+    }
+    for (;;)
+    {
+        size_t n = 0;
+        for (size_t i = 0; i < dups->count;)
+        {
+            size_t end = group_end(dups, i);
+            size_t first = SIZE_MAX;
+            for (size_t j = i; j < end && end - i > 1; j++)
+            {
+                struct dup_file *file = &dups->files[j];
+                if (file->failed || file->same_as != SIZE_MAX)
+                {
+                    continue;
+                }
+                if (first == SIZE_MAX)
+                {
+                    first = j;
+                    continue;
+                }
+                file->same_as = first;
+                todo[n++] = j;
+            }
+            if (first != SIZE_MAX && n > 0 && dups->files[todo[n - 1]].same_as == first)
+            {
+                dups->files[first].same_as = first; // Takes no further part
+            }
+            i = end;
+        }
+        if (n == 0)
+        {
+            return;
+        }
+        run_stage(dups, todo, n, PASS_VERIFY, workers);
+        // A first file that could not be read is reported once and left
+        // out; the rest of its group is regrouped around another file
+        for (size_t k = 0; k < n; k++)
+        {
+            struct dup_file *file = &dups->files[todo[k]];
+            struct dup_file *first = &dups->files[file->same_as];
+            if (file->ref_error && !first->failed)
+            {
+                fprintf(stderr, "Error: Cannot read '%s'. %s.\n", path_of(dups, first),
+                        file->ref_error > 0 ? strerror(file->ref_error) : "File got shorter");
+                first->failed = 1;
+            }
+        }
+        for (size_t k = 0; k < n; k++)
+        {
+            struct dup_file *file = &dups->files[todo[k]];
+            struct dup_file *first = &dups->files[file->same_as];
+            if (first->failed)
+            {
+                file->same_as = SIZE_MAX;
+                file->verified = 0;
+                file->ref_error = 0;
+            }
+            else if (file->verified)
+            {
+                first->verified = 1;
+            }
+        }
+    }
+}
+
+int dups_report(struct dups *dups, int workers)
+{
+    size_t *todo = malloc((dups->count ? dups->count : 1) * sizeof(*todo));
+    if (!todo)
+    {
+        fprintf(stderr, "Error: malloc() failed. %s.\n", strerror(errno));
+        return -1;
+    }
+
+    // Same size: hash the head and tail; same head and tail: hash it all;
+    // same hashes: compare the bytes
+    run_stage(dups, todo, collect_collisions(dups, todo, 0), PASS_SAMPLE, workers);
+    run_stage(dups, todo, collect_collisions(dups, todo, 1), PASS_FULL, workers);
+    sorting = dups;
+    qsort(dups->files, dups->count, sizeof(*dups->files), compare_files);
+    verify_groups(dups, todo, workers);
+    free(todo);
+
+    // Within each hash group, every verified file was found identical to
+    // the first file of its set (same_as); print each set of two or more
+    for (size_t i = 0; i < dups->count;)
+    {
+        size_t end = group_end(dups, i);
+        for (size_t first = i; first < end; first++)
+        {
+            if (!dups->files[first].verified || dups->files[first].same_as != first)
+            {
+                continue;
+            }
+            for (size_t j = first; j < end; j++)
+            {
+                const struct dup_file *file = &dups->files[j];
+                if (file->verified && !file->failed && file->same_as == first)
+                {
+                    const char *path = path_of(dups, file);
+                    out_path(path, strlen(path));
+                }
+            }
+            out_group_end();
+        }
+        i = end;
+    }
+    return 0;
+}
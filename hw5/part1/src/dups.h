@@ -0,0 +1,50 @@
+#ifndef DUPS_H
+#define DUPS_H
+
+#include <stddef.h>    // For size_t
+#include <sys/types.h> // For off_t
+
+// --duplicates: groups files with identical contents. Files are narrowed
+// down in stages, each only looking at files the previous one could not
+// tell apart: equal size, then a hash of the first and last DUPS_SAMPLE
+// bytes, then a hash of the whole file, then a byte for byte comparison
+// with the first file of its group. A file whose size is unique is never
+// opened.
+#define DUPS_SAMPLE (4 * 1024)
+
+struct dup_file
+{
+    size_t path;       // Offset into the path buffer
+    off_t size;
+    unsigned long long sample[2]; // Hash of the head and tail
+    unsigned long long full[2];   // Hash of the whole file
+    size_t same_as;    // File it was found (or is being checked) to be identical to
+    int verified;      // Byte for byte identical to same_as
+    int failed;        // Could not be read; left out of every group
+    int ref_error;     // errno from reading same_as (-1: it got shorter), 0 if none
+};
+
+struct dups
+{
+    struct dup_file *files;
+    size_t count;
+    size_t cap;
+    char *paths; // Every path, NUL-terminated, back to back
+    size_t used;
+    size_t paths_cap;
+};
+
+void dups_init(struct dups *dups);
+void dups_free(struct dups *dups);
+
+// Adds a candidate file. Returns 0, or -1 on allocation failure (an error
+// has been printed).
+int dups_add(struct dups *dups, const char *path, size_t len, off_t size);
+
+// Hashes what has to be hashed, reading files on workers threads, and
+// reports every group of identical files with out_path(), largest files
+// first, each group followed by out_group_end(). Returns 0, or -1 if the
+// files could not be compared (an error has been printed).
+int dups_report(struct dups *dups, int workers);
+
+#endif
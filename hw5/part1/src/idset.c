@@ -0,0 +1,104 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>  // For fprintf
+#include <stdlib.h> // For malloc, free
+#include <string.h> // For strerror
+#include <errno.h>  // For errno
+#include "idset.h"
+
+#define EMPTY UINT64_MAX // dev and ino of an unused slot
+
+// splitmix64 finalizer: inode numbers are often sequential, so mix well
+static uint64_t mix(uint64_t x)
+{
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+static size_t slot_of(const struct idset *set, uint64_t dev, uint64_t ino)
+{
+    return mix(ino ^ mix(dev)) & set->mask;
+}
+
+void idset_init(struct idset *set)
+{
+    set->slots = NULL;
+    set->mask = 0;
+    set->count = 0;
+}
+
+void idset_free(struct idset *set)
+{
+    free(set->slots);
+    idset_init(set);
+}
+
+static struct file_id *alloc_slots(size_t n)
+{
+    struct file_id *slots = malloc(n * sizeof(*slots));
+    if (!slots)
+    {
+        fprintf(stderr, "Error: malloc() failed. %s.\n", strerror(errno));
+        return NULL;
+    }
+    for (size_t i = 0; i < n; i++)
+    {
+        slots[i].dev = EMPTY;
+        slots[i].ino = EMPTY;
+    }
+    return slots;
+}
+
+// Doubles the table (or creates it), keeping the load factor below 1/2
+static int grow(struct idset *set)
+{
+    size_t old_size = set->slots ? set->mask + 1 : 0;
+    size_t new_size = old_size ? old_size * 2 : 256;
+    struct file_id *slots = alloc_slots(new_size);
+    if (!slots)
+    {
+        return -1;
+    }
+
+    struct file_id *old = set->slots;
+    set->slots = slots;
+    set->mask = new_size - 1;
+    for (size_t i = 0; i < old_size; i++)
+    {
+        if (old[i].dev != EMPTY || old[i].ino != EMPTY)
+        {
+            size_t s = slot_of(set, old[i].dev, old[i].ino);
+            while (slots[s].dev != EMPTY || slots[s].ino != EMPTY)
+            {
+                s = (s + 1) & set->mask;
+            }
+            slots[s] = old[i];
+        }
+    }
+    free(old);
+    return 0;
+}
+
+int idset_insert(struct idset *set, dev_t dev, ino_t ino)
+{
+    if ((!set->slots || (set->count + 1) * 2 > set->mask + 1) && grow(set) < 0)
+    {
+        return -1;
+    }
+
+    size_t s = slot_of(set, (uint64_t)dev, (uint64_t)ino);
+    while (set->slots[s].dev != EMPTY || set->slots[s].ino != EMPTY)
+    {
+        if (set->slots[s].dev == (uint64_t)dev && set->slots[s].ino == (uint64_t)ino)
+        {
+            return 0;
+        }
+        s = (s + 1) & set->mask;
+    }
+    set->slots[s].dev = (uint64_t)dev;
+    set->slots[s].ino = (uint64_t)ino;
+    set->count++;
+    return 1;
+}
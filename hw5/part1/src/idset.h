@@ -0,0 +1,31 @@
+#ifndef IDSET_H
+#define IDSET_H
+
+#include <stddef.h>    // For size_t
+#include <stdint.h>    // For uint64_t
+#include <sys/types.h> // For dev_t, ino_t
+
+// Identity of a file: the same (dev, ino) pair is the same file, whatever
+// path (hard link, bind mount, symlink) it was reached through
+struct file_id
+{
+    uint64_t dev;
+    uint64_t ino;
+};
+
+// Open-addressing hash set of file identities with linear probing
+struct idset
+{
+    struct file_id *slots;
+    size_t mask;  // Number of slots - 1 (a power of two), or 0 before first insert
+    size_t count; // Occupied slots
+};
+
+void idset_init(struct idset *set);
+void idset_free(struct idset *set);
+
+// Adds (dev, ino). Returns 1 if it was new, 0 if it was already present and
+// -1 if the table could not grow (an error has been printed).
+int idset_insert(struct idset *set, dev_t dev, ino_t ino);
+
+#endif
@@ -0,0 +1,776 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>    // For fprintf, fopen, fwrite
+#include <stdlib.h>   // For malloc, realloc, qsort
+#include <stdint.h>   // For fixed width column types
+#include <stddef.h>   // For offsetof
+#include <string.h>   // For strcmp, strerror
+#include <errno.h>    // For errno
+#include <limits.h>   // For PATH_MAX
+#include <dirent.h>   // For opendir, readdir
+#include <fcntl.h>    // For open, AT_SYMLINK_NOFOLLOW
+#include <unistd.h>   // For close
+#include <sys/mman.h> // For mmap
+#include <sys/stat.h> // For lstat, fstat, fstatat
+#include "pfind.h"
+#include "index.h"
+#include "out.h"
+
+/*
+ * Index file layout (native endian, every column starts 8-byte aligned):
+ *
+ *   header
+ *   mode[count]        uint32   st_mode
+ *   first_child[count] uint32   directories: index of their first child
+ *   nchild[count]      uint32   directories: number of children
+ *   size[count]        uint64   st_size
+ *   mtime[count]       int64    st_mtim in nanoseconds
+ *   dev[count]         uint64   st_dev
+ *   ino[count]         uint64   st_ino
+ *   names                       front-coded full paths
+ *
+ * Entry 0 is the root directory. The children of every directory are stored
+ * as one contiguous block sorted by name, so a directory can be copied over
+ * as a unit on refresh and neighbouring paths share long prefixes. Each name
+ * is stored as <varint shared prefix length with the previous path>
+ * <varint suffix length> <suffix bytes>.
+ */
+
+struct index_header
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t count;
+    uint64_t mode_off;
+    uint64_t first_child_off;
+    uint64_t nchild_off;
+    uint64_t size_off;
+    uint64_t mtime_off;
+    uint64_t dev_off;
+    uint64_t ino_off;
+    uint64_t names_off;
+    uint64_t names_size;
+};
+
+// A read-only mapping of an index file with its columns resolved
+struct index_map
+{
+    void *base;
+    size_t length;
+    uint32_t count;
+    const uint32_t *mode;
+    const uint32_t *first_child;
+    const uint32_t *nchild;
+    const uint64_t *size;
+    const int64_t *mtime;
+    const uint64_t *dev;
+    const uint64_t *ino;
+    const unsigned char *names;
+    size_t names_size;
+};
+
+// An entry while the index is being built
+struct record
+{
+    char *path;
+    uint32_t mode;
+    uint32_t first_child;
+    uint32_t nchild;
+    uint64_t size;
+    int64_t mtime;
+    uint64_t dev;
+    uint64_t ino;
+};
+
+// The previous index, decoded so directories can be looked up by path
+struct old_index
+{
+    struct index_map map;
+    char *arena;       // every decoded path, NUL-terminated, back to back
+    size_t *path_off;  // offset of each entry's path in arena
+    uint32_t *table;   // open addressing: directory entry index + 1, 0 = empty
+    size_t table_mask; // table size - 1 (table size is a power of two)
+};
+
+struct builder
+{
+    struct record *recs;
+    size_t count;
+    size_t cap;
+    struct old_index *old; // NULL on a full rebuild
+};
+
+static uint64_t align8(uint64_t off)
+{
+    return (off + 7) & ~(uint64_t)7;
+}
+
+static int64_t mtime_ns(const struct stat *st)
+{
+    return (int64_t)st->st_mtim.tv_sec * 1000000000 + st->st_mtim.tv_nsec;
+}
+
+// FNV-1a, used to hash directory paths of the previous index
+static uint64_t hash_path(const char *path)
+{
+    uint64_t h = 14695981039346656037ULL;
+    for (; *path; path++)
+    {
+        h ^= (unsigned char)*path;
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+static size_t put_varint(unsigned char *out, uint64_t value)
+{
+    size_t n = 0;
+    while (value >= 0x80)
+    {
+        out[n++] = (unsigned char)(value | 0x80);
+        value >>= 7;
+    }
+    out[n++] = (unsigned char)value;
+    return n;
+}
+
+static int get_varint(const unsigned char *buf, size_t size, size_t *pos, uint64_t *value)
+{
+    uint64_t result = 0;
+    for (int shift = 0; shift < 64 && *pos < size; shift += 7)
+    {
+        unsigned char byte = buf[(*pos)++];
+        result |= (uint64_t)(byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+        {
+            *value = result;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+// Decodes the next front-coded name into path (which holds the previous one)
+static int decode_name(const struct index_map *map, size_t *pos, char *path, size_t *len)
+{
+    uint64_t shared, suffix;
+    if (get_varint(map->names, map->names_size, pos, &shared) < 0 ||
+        get_varint(map->names, map->names_size, pos, &suffix) < 0)
+    {
+        return -1;
+    }
+    if (shared > *len || shared + suffix >= PATH_MAX || suffix > map->names_size - *pos)
+    {
+        return -1;
+    }
+    memcpy(path + shared, map->names + *pos, suffix);
+    *pos += suffix;
+    *len = shared + suffix;
+    path[*len] = '\0';
+    return 0;
+}
+
+static int column_ok(uint64_t off, uint64_t count, uint64_t width, size_t length)
+{
+    return off % 8 == 0 && off <= length && count * width <= length - off;
+}
+
+// Maps index_file and validates its header. With quiet set, a missing or
+// foreign file is not reported (used when probing for an index to refresh).
+static int index_open(const char *index_file, struct index_map *map, int quiet)
+{
+    int fd = open(index_file, O_RDONLY);
+    if (fd < 0)
+    {
+        if (!quiet || errno != ENOENT)
+        {
+            fprintf(stderr, "Error: Cannot open index '%s'. %s.\n", index_file, strerror(errno));
+        }
+        return -1;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) < 0)
+    {
+        fprintf(stderr, "Error: Cannot stat index '%s'. %s.\n", index_file, strerror(errno));
+        close(fd);
+        return -1;
+    }
+    if ((size_t)st.st_size < sizeof(struct index_header))
+    {
+        if (!quiet)
+        {
+            fprintf(stderr, "Error: '%s' is not a pfind index.\n", index_file);
+        }
+        close(fd);
+        return -1;
+    }
+
+    void *base = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd); // The mapping keeps the file alive
+    if (base == MAP_FAILED)
+    {
+        fprintf(stderr, "Error: Cannot map index '%s'. %s.\n", index_file, strerror(errno));
+        return -1;
+    }
+
+    const struct index_header *hdr = base;
+    size_t length = (size_t)st.st_size;
+    uint64_t count = hdr->count;
+    if (memcmp(hdr->magic, INDEX_MAGIC, sizeof(hdr->magic)) != 0 || hdr->version != INDEX_VERSION ||
+        !column_ok(hdr->mode_off, count, 4, length) || !column_ok(hdr->first_child_off, count, 4, length) ||
+        !column_ok(hdr->nchild_off, count, 4, length) || !column_ok(hdr->size_off, count, 8, length) ||
+        !column_ok(hdr->mtime_off, count, 8, length) || !column_ok(hdr->dev_off, count, 8, length) ||
+        !column_ok(hdr->ino_off, count, 8, length) || hdr->names_off > length ||
+        hdr->names_size > length - hdr->names_off)
+    {
+        if (!quiet)
+        {
+            fprintf(stderr, "Error: '%s' is not a valid pfind index.\n", index_file);
+        }
+        munmap(base, length);
+        return -1;
+    }
+
+    const char *bytes = base;
+    map->base = base;
+    map->length = length;
+    map->count = hdr->count;
+    map->mode = (const uint32_t *)(bytes + hdr->mode_off);
+    map->first_child = (const uint32_t *)(bytes + hdr->first_child_off);
+    map->nchild = (const uint32_t *)(bytes + hdr->nchild_off);
+    map->size = (const uint64_t *)(bytes + hdr->size_off);
+    map->mtime = (const int64_t *)(bytes + hdr->mtime_off);
+    map->dev = (const uint64_t *)(bytes + hdr->dev_off);
+    map->ino = (const uint64_t *)(bytes + hdr->ino_off);
+    map->names = (const unsigned char *)(bytes + hdr->names_off);
+    map->names_size = hdr->names_size;
+    return 0;
+}
+
+static void index_close(struct index_map *map)
+{
+    munmap(map->base, map->length);
+}
+
+static void old_index_free(struct old_index *old)
+{
+    free(old->arena);
+    free(old->path_off);
+    free(old->table);
+    index_close(&old->map);
+}
+
+// Loads the previous index and hashes its directories by path.
+// Returns -1 if there is no usable index (the caller then does a full scan).
+static int old_index_load(const char *index_file, struct old_index *old)
+{
+    memset(old, 0, sizeof(*old));
+    if (index_open(index_file, &old->map, 1) < 0)
+    {
+        return -1;
+    }
+
+    const struct index_map *map = &old->map;
+    size_t arena_cap = 4096, arena_len = 0, dirs = 0;
+    old->arena = malloc(arena_cap);
+    old->path_off = malloc((map->count ? map->count : 1) * sizeof(size_t));
+    if (!old->arena || !old->path_off)
+    {
+        fprintf(stderr, "Error: malloc() failed. %s.\n", strerror(errno));
+        old_index_free(old);
+        return -1;
+    }
+
+    char path[PATH_MAX];
+    size_t len = 0, pos = 0;
+    for (uint32_t i = 0; i < map->count; i++)
+    {
+        if (decode_name(map, &pos, path, &len) < 0 ||
+            (S_ISDIR(map->mode[i]) && (uint64_t)map->first_child[i] + map->nchild[i] > map->count))
+        {
+            fprintf(stderr, "Error: Index '%s' is corrupt, rebuilding it.\n", index_file);
+            old_index_free(old);
+            return -1;
+        }
+        if (arena_len + len + 1 > arena_cap)
+        {
+            while (arena_len + len + 1 > arena_cap)
+            {
+                arena_cap *= 2;
+            }
+            char *grown = realloc(old->arena, arena_cap);
+            if (!grown)
+            {
+                fprintf(stderr, "Error: realloc() failed. %s.\n", strerror(errno));
+                old_index_free(old);
+                return -1;
+            }
+            old->arena = grown;
+        }
+        memcpy(old->arena + arena_len, path, len + 1);
+        old->path_off[i] = arena_len;
+        arena_len += len + 1;
+        dirs += S_ISDIR(map->mode[i]) != 0;
+    }
+
+    size_t table_size = 16;
+    while (table_size < dirs * 2)
+    {
+        table_size *= 2;
+    }
+    old->table = calloc(table_size, sizeof(uint32_t));
+    if (!old->table)
+    {
+        fprintf(stderr, "Error: calloc() failed. %s.\n", strerror(errno));
+        old_index_free(old);
+        return -1;
+    }
+    old->table_mask = table_size - 1;
+    for (uint32_t i = 0; i < map->count; i++)
+    {
+        if (S_ISDIR(map->mode[i]))
+        {
+            size_t slot = hash_path(old->arena + old->path_off[i]) & old->table_mask;
+            while (old->table[slot])
+            {
+                slot = (slot + 1) & old->table_mask;
+            }
+            old->table[slot] = i + 1;
+        }
+    }
+    return 0;
+}
+
+// Returns the previous entry index of directory dir_path, or -1
+static long old_index_find(const struct old_index *old, const char *dir_path)
+{
+    size_t slot = hash_path(dir_path) & old->table_mask;
+    while (old->table[slot])
+    {
+        uint32_t i = old->table[slot] - 1;
+        if (strcmp(old->arena + old->path_off[i], dir_path) == 0)
+        {
+            return i;
+        }
+        slot = (slot + 1) & old->table_mask;
+    }
+    return -1;
+}
+
+static void fill_from_stat(struct record *rec, const struct stat *st)
+{
+    rec->mode = st->st_mode;
+    rec->size = (uint64_t)st->st_size;
+    rec->mtime = mtime_ns(st);
+    rec->dev = st->st_dev;
+    rec->ino = st->st_ino;
+    rec->first_child = 0;
+    rec->nchild = 0;
+}
+
+// Appends an entry; takes ownership of path (which is freed on failure)
+static struct record *push_record(struct builder *b, char *path)
+{
+    if (b->count == UINT32_MAX)
+    {
+        fprintf(stderr, "Error: Too many entries for one index.\n");
+        free(path);
+        return NULL;
+    }
+    if (b->count == b->cap)
+    {
+        size_t cap = b->cap ? b->cap * 2 : 1024;
+        struct record *grown = realloc(b->recs, cap * sizeof(*grown));
+        if (!grown)
+        {
+            fprintf(stderr, "Error: realloc() failed. %s.\n", strerror(errno));
+            free(path);
+            return NULL;
+        }
+        b->recs = grown;
+        b->cap = cap;
+    }
+    struct record *rec = &b->recs[b->count++];
+    memset(rec, 0, sizeof(*rec));
+    rec->path = path;
+    return rec;
+}
+
+// Copies the children of an unchanged directory from the previous index
+// instead of reading the directory again: its mtime says no entry was
+// added, removed or renamed. A chmod or a write inside it does not change
+// that mtime, so every child is still fstatat()ed by name for its current
+// mode, size and mtime.
+static int reuse_block(struct builder *b, const char *dir_path, uint32_t old_dir)
+{
+    int dir_fd = open(dir_path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dir_fd < 0)
+    {
+        fprintf(stderr, "Error: Cannot open directory '%s'.\n", dir_path);
+        return 0; // Indexed without children, as read_block() does
+    }
+
+    const struct old_index *old = b->old;
+    uint32_t first = old->map.first_child[old_dir];
+    int rc = 0;
+    for (uint32_t i = first; i < first + old->map.nchild[old_dir] && rc == 0; i++)
+    {
+        const char *old_path = old->arena + old->path_off[i];
+        struct stat st;
+        if (fstatat(dir_fd, strrchr(old_path, '/') + 1, &st, AT_SYMLINK_NOFOLLOW) < 0)
+        {
+            fprintf(stderr, "Error: Cannot stat '%s'.\n", old_path);
+            continue;
+        }
+
+        char *path = strdup(old_path);
+        if (!path)
+        {
+            fprintf(stderr, "Error: strdup() failed. %s.\n", strerror(errno));
+            rc = -1;
+            break;
+        }
+        struct record *rec = push_record(b, path);
+        if (!rec)
+        {
+            rc = -1;
+            break;
+        }
+        fill_from_stat(rec, &st);
+    }
+    close(dir_fd);
+    return rc;
+}
+
+// Reads a directory from disk, appending one record per entry
+static int read_block(struct builder *b, const char *dir_path)
+{
+    DIR *dir = opendir(dir_path);
+    if (dir == NULL)
+    {
+        fprintf(stderr, "Error: Cannot open directory '%s'.\n", dir_path);
+        return 0; // Unreadable directories are indexed without children
+    }
+
+    struct dirent *entry;
+    char full_path_name[PATH_MAX];
+    while ((entry = readdir(dir)) != NULL)
+    {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
+        {
+            continue;
+        }
+        if (snprintf(full_path_name, PATH_MAX, "%s/%s", dir_path, entry->d_name) >= PATH_MAX)
+        {
+            fprintf(stderr, "Error: Path too long '%s/%s'.\n", dir_path, entry->d_name);
+            continue;
+        }
+
+        struct stat st;
+        if (lstat(full_path_name, &st) < 0)
+        {
+            fprintf(stderr, "Error: Cannot stat '%s'.\n", full_path_name);
+            continue;
+        }
+
+        char *path = strdup(full_path_name);
+        if (!path)
+        {
+            fprintf(stderr, "Error: strdup() failed. %s.\n", strerror(errno));
+            closedir(dir);
+            return -1;
+        }
+        struct record *rec = push_record(b, path);
+        if (!rec)
+        {
+            closedir(dir);
+            return -1;
+        }
+        fill_from_stat(rec, &st);
+    }
+
+    closedir(dir);
+    return 0;
+}
+
+static int compare_records(const void *a, const void *b)
+{
+    return strcmp(((const struct record *)a)->path, ((const struct record *)b)->path);
+}
+
+// Fills in the block of children for directory recs[di], then its subdirectories
+static int scan_dir(struct builder *b, size_t di)
+{
+    size_t first = b->count;
+    const char *dir_path = b->recs[di].path; // Stays valid when recs is realloc()ed
+    long old_dir = b->old ? old_index_find(b->old, dir_path) : -1;
+
+    int rc;
+    if (old_dir >= 0 && b->old->map.dev[old_dir] == b->recs[di].dev &&
+        b->old->map.ino[old_dir] == b->recs[di].ino && b->old->map.mtime[old_dir] == b->recs[di].mtime)
+    {
+        rc = reuse_block(b, dir_path, (uint32_t)old_dir);
+    }
+    else
+    {
+        rc = read_block(b, dir_path);
+    }
+    if (rc < 0)
+    {
+        return -1;
+    }
+
+    size_t nchild = b->count - first;
+    qsort(b->recs + first, nchild, sizeof(*b->recs), compare_records);
+    b->recs[di].first_child = (uint32_t)first;
+    b->recs[di].nchild = (uint32_t)nchild;
+
+    for (size_t i = first; i < first + nchild; i++)
+    {
+        if (S_ISDIR(b->recs[i].mode) && scan_dir(b, i) < 0)
+        {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static int write_u32_column(FILE *fp, const struct builder *b, size_t field)
+{
+    for (size_t i = 0; i < b->count; i++)
+    {
+        uint32_t value;
+        memcpy(&value, (const char *)&b->recs[i] + field, sizeof(value));
+        if (fwrite(&value, sizeof(value), 1, fp) != 1)
+        {
+            return -1;
+        }
+    }
+    static const char pad[8];
+    size_t extra = align8(b->count * 4) - b->count * 4;
+    return extra && fwrite(pad, 1, extra, fp) != extra ? -1 : 0;
+}
+
+static int write_u64_column(FILE *fp, const struct builder *b, size_t field)
+{
+    for (size_t i = 0; i < b->count; i++)
+    {
+        uint64_t value;
+        memcpy(&value, (const char *)&b->recs[i] + field, sizeof(value));
+        if (fwrite(&value, sizeof(value), 1, fp) != 1)
+        {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// Front-codes every path into one buffer
+static unsigned char *encode_names(const struct builder *b, size_t *names_size)
+{
+    size_t cap = 4096, len = 0;
+    unsigned char *names = malloc(cap);
+    if (!names)
+    {
+        fprintf(stderr, "Error: malloc() failed. %s.\n", strerror(errno));
+        return NULL;
+    }
+
+    const char *prev = "";
+    for (size_t i = 0; i < b->count; i++)
+    {
+        const char *path = b->recs[i].path;
+        size_t shared = 0;
+        while (prev[shared] && prev[shared] == path[shared])
+        {
+            shared++;
+        }
+        size_t suffix = strlen(path + shared);
+
+        if (len + suffix + 20 > cap) // 20 bytes covers both varints
+        {
+            while (len + suffix + 20 > cap)
+            {
+                cap *= 2;
+            }
+            unsigned char *grown = realloc(names, cap);
+            if (!grown)
+            {
+                fprintf(stderr, "Error: realloc() failed. %s.\n", strerror(errno));
+                free(names);
+                return NULL;
+            }
+            names = grown;
+        }
+        len += put_varint(names + len, shared);
+        len += put_varint(names + len, suffix);
+        memcpy(names + len, path + shared, suffix);
+        len += suffix;
+        prev = path;
+    }
+
+    *names_size = len;
+    return names;
+}
+
+// Writes the index to a temporary file and renames it over index_file, so a
+// concurrent query (or the mapping of the previous index) never sees a torn file
+static int write_index(const struct builder *b, const char *index_file)
+{
+    char tmp_path[PATH_MAX];
+    if (snprintf(tmp_path, PATH_MAX, "%s.tmp", index_file) >= PATH_MAX)
+    {
+        fprintf(stderr, "Error: Index path too long '%s'.\n", index_file);
+        return -1;
+    }
+
+    size_t names_size;
+    unsigned char *names = encode_names(b, &names_size);
+    if (!names)
+    {
+        return -1;
+    }
+
+    struct index_header hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, INDEX_MAGIC, sizeof(hdr.magic));
+    hdr.version = INDEX_VERSION;
+    hdr.count = (uint32_t)b->count;
+    uint64_t off = align8(sizeof(hdr));
+    hdr.mode_off = off;
+    off += align8(b->count * 4);
+    hdr.first_child_off = off;
+    off += align8(b->count * 4);
+    hdr.nchild_off = off;
+    off += align8(b->count * 4);
+    hdr.size_off = off;
+    off += b->count * 8;
+    hdr.mtime_off = off;
+    off += b->count * 8;
+    hdr.dev_off = off;
+    off += b->count * 8;
+    hdr.ino_off = off;
+    off += b->count * 8;
+    hdr.names_off = off;
+    hdr.names_size = names_size;
+
+    FILE *fp = fopen(tmp_path, "wb");
+    if (!fp)
+    {
+        fprintf(stderr, "Error: Cannot create index '%s'. %s.\n", tmp_path, strerror(errno));
+        free(names);
+        return -1;
+    }
+
+    static const char pad[8];
+    int failed = fwrite(&hdr, sizeof(hdr), 1, fp) != 1 ||
+                 fwrite(pad, 1, align8(sizeof(hdr)) - sizeof(hdr), fp) != align8(sizeof(hdr)) - sizeof(hdr) ||
+                 write_u32_column(fp, b, offsetof(struct record, mode)) < 0 ||
+                 write_u32_column(fp, b, offsetof(struct record, first_child)) < 0 ||
+                 write_u32_column(fp, b, offsetof(struct record, nchild)) < 0 ||
+                 write_u64_column(fp, b, offsetof(struct record, size)) < 0 ||
+                 write_u64_column(fp, b, offsetof(struct record, mtime)) < 0 ||
+                 write_u64_column(fp, b, offsetof(struct record, dev)) < 0 ||
+                 write_u64_column(fp, b, offsetof(struct record, ino)) < 0 ||
+                 fwrite(names, 1, names_size, fp) != names_size;
+    free(names);
+    if (fclose(fp) != 0 || failed)
+    {
+        fprintf(stderr, "Error: Cannot write index '%s'. %s.\n", tmp_path, strerror(errno));
+        unlink(tmp_path);
+        return -1;
+    }
+
+    if (rename(tmp_path, index_file) < 0)
+    {
+        fprintf(stderr, "Error: Cannot replace index '%s'. %s.\n", index_file, strerror(errno));
+        unlink(tmp_path);
+        return -1;
+    }
+    return 0;
+}
+
+int index_build(const char *root_dir, const char *index_file)
+{
+    struct stat st;
+    if (lstat(root_dir, &st) < 0)
+    {
+        fprintf(stderr, "Error: Cannot stat '%s'. %s.\n", root_dir, strerror(errno));
+        return -1;
+    }
+    if (!S_ISDIR(st.st_mode))
+    {
+        fprintf(stderr, "Error: '%s' is not a directory.\n", root_dir);
+        return -1;
+    }
+
+    struct builder b;
+    memset(&b, 0, sizeof(b));
+    struct old_index old;
+    if (old_index_load(index_file, &old) == 0)
+    {
+        b.old = &old;
+    }
+
+    int rc = -1;
+    char *root = strdup(root_dir);
+    if (!root)
+    {
+        fprintf(stderr, "Error: strdup() failed. %s.\n", strerror(errno));
+    }
+    else
+    {
+        struct record *rec = push_record(&b, root);
+        if (rec)
+        {
+            fill_from_stat(rec, &st);
+            rc = scan_dir(&b, 0);
+        }
+    }
+
+    if (rc == 0)
+    {
+        rc = write_index(&b, index_file);
+    }
+
+    for (size_t i = 0; i < b.count; i++)
+    {
+        free(b.recs[i].path);
+    }
+    free(b.recs);
+    if (b.old)
+    {
+        old_index_free(&old);
+    }
+    return rc;
+}
+
+int index_query(const char *index_file, mode_t perm_mode)
+{
+    struct index_map map;
+    if (index_open(index_file, &map, 0) < 0)
+    {
+        return -1;
+    }
+
+    int rc = 0;
+    char path[PATH_MAX];
+    size_t len = 0, pos = 0;
+    for (uint32_t i = 0; i < map.count; i++)
+    {
+        // Names are front-coded, so every one is decoded to keep the prefix current
+        if (decode_name(&map, &pos, path, &len) < 0)
+        {
+            fprintf(stderr, "Error: Index '%s' is corrupt.\n", index_file);
+            rc = -1;
+            break;
+        }
+        if (mode_matches(map.mode[i], perm_mode))
+        {
+            out_path(path, len);
+        }
+    }
+
+    index_close(&map);
+    return rc;
+}
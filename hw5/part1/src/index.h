@@ -0,0 +1,22 @@
+#ifndef INDEX_H
+#define INDEX_H
+
+#include <sys/types.h> // For mode_t
+
+// On-disk metadata index (see index.c for the file layout)
+#define INDEX_MAGIC "PFINDIX1"
+#define INDEX_VERSION 1
+
+// Builds (or incrementally refreshes) the index for root_dir in index_file.
+// If index_file already holds an index of the same root, the entries of
+// directories whose mtime did not change are taken from it instead of
+// being read with readdir() again; each is still stat()ed, so permission,
+// size and mtime changes are picked up.
+// Returns 0 on success, -1 on failure (an error has been printed).
+int index_build(const char *root_dir, const char *index_file);
+
+// Prints every indexed regular file whose permissions equal perm_mode.
+// Returns 0 on success, -1 on failure (an error has been printed).
+int index_query(const char *index_file, mode_t perm_mode);
+
+#endif
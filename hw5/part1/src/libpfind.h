@@ -0,0 +1,90 @@
+#ifndef LIBPFIND_H
+#define LIBPFIND_H
+
+#include <stddef.h>    // For size_t
+#include <sys/types.h> // For mode_t
+#include <sys/stat.h>  // For struct stat
+#include "prune.h"
+#include "stats.h"
+
+// libpfind: pfind's directory walk as a library (libpfind.a). Set up a
+// struct pfind_options, then either pass a callback to pfind_walk() or pull
+// entries one at a time with pfind_open()/pfind_next()/pfind_close().
+
+// Entries directly inside the starting directory are at depth 1
+#define PFIND_UNLIMITED (-1)
+
+struct pfind_options
+{
+    const char *perm;   // Only report regular files with exactly these permissions
+                        // ("rwxr-x---"), or NULL to report every entry
+    int follow_links;   // -L: stat() through symlinks (cycles are detected)
+    int same_fs;        // -xdev: do not descend into other filesystems
+    int dedup_links;    // Report a file with several hard links only once
+    int min_depth;      // -mindepth: only report entries at least this deep
+    int max_depth;      // -maxdepth: do not go deeper than this, PFIND_UNLIMITED for no limit
+    const struct prune_list *prune; // Entries to skip entirely, or NULL
+    struct walk_stats *stats;       // --stats/--progress counters, or NULL to skip counting
+    int inode_order;    // --order=inode: stat a directory's entries sorted by inode number
+    int breadth_first;  // --bfs: walk level by level instead of depth-first
+    int max_open;       // --max-open: directory streams kept open at once, 0 for the default
+};
+
+// Defaults: report everything, no depth limit, depth-first in readdir order
+void pfind_options_init(struct pfind_options *opts);
+
+// One reported entry. It (and path) is only valid until the next
+// pfind_next() call, or until the callback returns.
+struct pfind_entry
+{
+    const char *path; // Starting directory, '/', then the path below it
+    size_t path_len;
+    const char *name; // Last component, inside path
+    int depth;
+    mode_t type;      // File type bits (S_IFREG, ...) or 0 if not yet known
+};
+
+// The entry's stat data (lstat, or stat with follow_links). Entries that
+// no option needed to stat are stat()ed on the first call only. NULL if
+// that fails (an error has been printed).
+const struct stat *pfind_stat(struct pfind_entry *entry);
+
+// Callback for pfind_walk(); a non-zero return stops the walk
+typedef int (*pfind_fn)(struct pfind_entry *entry, void *ctx);
+
+// Walks dir_path calling fn for every reported entry. Returns 0 after a
+// full walk, fn's non-zero value if it stopped the walk, or -1 if the walk
+// could not start (an error has been printed).
+int pfind_walk(const char *dir_path, const struct pfind_options *opts, pfind_fn fn, void *ctx);
+
+// Pull-style iterator over the same entries as pfind_walk(). pfind_open()
+// returns NULL if the walk cannot start (an error has been printed).
+struct pfind_iter;
+struct pfind_iter *pfind_open(const char *dir_path, const struct pfind_options *opts);
+struct pfind_entry *pfind_next(struct pfind_iter *iter); // NULL at the end
+void pfind_close(struct pfind_iter *iter);
+
+// How the walk behaves:
+// A directory (by dev and inode) that is already being walked is not
+// entered again, so bind mount and symlink loops end. With follow_links,
+// dedup_links or breadth_first every directory walked is remembered and
+// none is walked twice, at the cost of memory that grows with the number
+// of directories. Pruned entries are skipped before they are stat()ed, so
+// a pruned subtree costs no I/O, and an entry whose readdir() type already
+// tells it cannot match is not stat()ed either.
+// With inode_order each directory is read in full and its entries stat()ed
+// in d_ino order, which turns the inode table reads of a cold scan on a
+// disk into mostly forward seeks. breadth_first walks the tree level by
+// level; the queue of waiting directories is bounded, and subdirectories
+// found while it is full are walked depth-first instead.
+// The walk is iterative: apart from those sets, memory grows with the
+// depth of the tree, not its size, and paths are not limited to PATH_MAX
+// by a fixed buffer. Entries are opened and stat()ed by name relative to
+// their open directory, so the cost per entry does not grow with depth.
+// At most max_open directories (capped by RLIMIT_NOFILE) are open at once;
+// past that the outermost one is closed and later reopened at its
+// telldir() position.
+// Unreadable directories and entries, and errors while reading a
+// directory, are reported on stderr and skipped.
+
+#endif
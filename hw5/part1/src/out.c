@@ -0,0 +1,103 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>  // For fprintf, snprintf
+#include <string.h> // For memcpy, strerror
+#include <errno.h>  // For errno
+#include <time.h>   // For clock_gettime
+#include <unistd.h> // For write
+#include "out.h"
+
+static char buffer[OUT_BUFFER];
+static size_t used;                 // Bytes of buffer waiting to be written
+static char terminator = '\n';      // '\0' with -0
+static int count_only;              // --count: nothing but the total is printed
+static unsigned long long matches;  // Number of paths reported
+static int failed;                  // A write failed; later output is dropped
+static unsigned long long written;  // Bytes written to stdout
+static double write_seconds;        // Time spent inside write()
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+void out_init(int nul_terminated, int count)
+{
+    terminator = nul_terminated ? '\0' : '\n';
+    count_only = count;
+}
+
+int out_flush(void)
+{
+    size_t done = 0;
+    double start = now(); // Once per buffer, so the clock is cheap here
+    while (done < used && !failed)
+    {
+        ssize_t n = write(STDOUT_FILENO, buffer + done, used - done);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            fprintf(stderr, "Error: Cannot write output. %s.\n", strerror(errno));
+            failed = 1;
+            break;
+        }
+        done += (size_t)n;
+    }
+    write_seconds += now() - start;
+    written += done;
+    used = 0;
+    return failed ? -1 : 0;
+}
+
+void out_path(const char *path, size_t len)
+{
+    matches++;
+    if (count_only)
+    {
+        return;
+    }
+
+    if (used + len + 1 > OUT_BUFFER)
+    {
+        out_flush();
+        if (len + 1 > OUT_BUFFER) // Cannot happen for paths shorter than PATH_MAX
+        {
+            return;
+        }
+    }
+    memcpy(buffer + used, path, len);
+    used += len;
+    buffer[used++] = terminator;
+}
+
+void out_group_end(void)
+{
+    if (count_only)
+    {
+        return;
+    }
+    if (used + 1 > OUT_BUFFER)
+    {
+        out_flush();
+    }
+    buffer[used++] = terminator;
+}
+
+void out_totals(unsigned long long *bytes, double *seconds)
+{
+    *bytes = written;
+    *seconds = write_seconds;
+}
+
+int out_finish(void)
+{
+    if (count_only)
+    {
+        used = (size_t)snprintf(buffer, OUT_BUFFER, "%llu\n", matches);
+    }
+    return out_flush();
+}
@@ -0,0 +1,31 @@
+#ifndef OUT_H
+#define OUT_H
+
+#include <stddef.h> // For size_t
+
+// Size of the output buffer; matches are written with one write() per buffer
+#define OUT_BUFFER (1024 * 1024)
+
+// Selects the output format before the first out_path():
+// nul_terminated ends every path with '\0' instead of '\n' (-0), and
+// count_only suppresses the paths and only counts them (--count)
+void out_init(int nul_terminated, int count_only);
+
+// Reports one matching path of length len
+void out_path(const char *path, size_t len);
+
+// Ends a group of paths (--duplicates) with an empty line, or an empty
+// '\0'-terminated record with -0; nothing in --count mode
+void out_group_end(void);
+
+// Writes out everything buffered so far. Returns 0, or -1 on a write error.
+int out_flush(void);
+
+// Bytes written to stdout so far and the time spent inside write()
+void out_totals(unsigned long long *bytes, double *seconds);
+
+// Writes the match count in --count mode, then flushes.
+// Returns 0, or -1 if any write failed.
+int out_finish(void);
+
+#endif
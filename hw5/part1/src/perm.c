@@ -0,0 +1,46 @@
+#define _POSIX_C_SOURCE 200809L
+#include <regex.h>    // For regcomp, regexec
+#include <stdio.h>    // For fprintf
+#include <sys/stat.h> // For S_ISREG
+#include "pfind.h"
+
+int perm_is_valid(const char *perm_string)
+{
+    regex_t regex;
+    int return_value;
+    // Compile regex pattern:
+    // ^(r|-)(w|-)(x|-)(r|-)(w|-)(x|-)(r|-)(w|-)(x|-)$ --- Could I rewrite this with modulo per 3 characters?
+    // Beginning of string ^, 3 sets of (r|-)(w|-)(x|-), and end of string $
+    // regcomp returns 0 on success, non-zero on failure
+    return_value = regcomp(&regex, "^(r|-)(w|-)(x|-)(r|-)(w|-)(x|-)(r|-)(w|-)(x|-)$", REG_EXTENDED);
+    if (return_value) // Because regcomp returns 0 on success, if(ret) to check for failure
+    {
+        fprintf(stderr, "Error: Could not compile regex.\n");
+        return 0;
+    }
+    // Execute regex compare on the permissions string
+    return_value = regexec(&regex, perm_string, 0, NULL, 0);
+    // &regex is reference to the compiled regex, perm_string is comparing string,
+    // first 0 is for number of matches, NULL is a pointer to store match info, and last 0 is for no execution options
+    regfree(&regex); // Free the compiled regex
+    return return_value == 0;
+}
+
+mode_t perm_to_mode(const char *perm_string)
+{
+    mode_t mode = 0;
+    for (int i = 0; i < 9; i++) // Bit 8 is user read, bit 0 is other execute
+    {
+        if (perm_string[i] != '-')
+        {
+            mode |= (mode_t)1 << (8 - i);
+        }
+    }
+    return mode;
+}
+
+int mode_matches(mode_t st_mode, mode_t perm_mode)
+{
+    // Only checks regular files (not directories)
+    return S_ISREG(st_mode) && (st_mode & PERM_MASK) == perm_mode;
+}
@@ -3,80 +3,99 @@
 #include <stdio.h>              // printf, fprintf
 #include <stdlib.h>             // EXIT_SUCCESS, EXIT_FAILURE
 #include <string.h>
-#include <regex.h>
+#include <errno.h>    // For errno (strtol)
+#include <limits.h>   // For INT_MAX
 #include <dirent.h>   // For opendir and closedir
-#include <sys/stat.h> // For lstat()
-#include <limits.h>   // For PATH_MAX
+#include <getopt.h>   // For getopt_long_only
+#include "pfind.h"
+#include "libpfind.h"
+#include "index.h"
+#include "watch.h"
+#include "out.h"
+#include "contains.h"
+#include "dups.h"
+
+// Most -contains worker threads started by default
+#define MAX_JOBS 16
+
+// Values for options that only have a long form
+enum
+{
+    OPT_INDEX = 256,
+    OPT_USE_INDEX,
+    OPT_WATCH,
+    OPT_COUNT,
+    OPT_XDEV,
+    OPT_DEDUP_LINKS,
+    OPT_MAXDEPTH,
+    OPT_MINDEPTH,
+    OPT_PRUNE,
+    OPT_EXCLUDE_FROM,
+    OPT_STATS,
+    OPT_PROGRESS,
+    OPT_ORDER,
+    OPT_BFS,
+    OPT_MAX_OPEN,
+    OPT_CONTAINS,
+    OPT_JOBS,
+    OPT_DUPLICATES
+};
 
 // Standard usage message
 void print_usage(void)
 {
-    printf("Usage: ./pfind -d <directory> -p <permissions string> [-h]\n");
+    printf("Usage: ./pfind -d <directory> -p <permissions string> [-0] [--count] [-L] [-xdev]\n"
+           "             [--dedup-links] [-maxdepth <n>] [-mindepth <n>] [-prune <pattern>]...\n"
+           "             [-exclude-from <file>] [--stats] [--progress[=<seconds>]]\n"
+           "             [--order=readdir|inode] [--bfs] [--max-open <n>]\n"
+           "             [-contains <string>] [--jobs <n>] [-h]\n");
+    printf("       ./pfind -d <directory> --duplicates [-p <permissions string>] [--jobs <n>] [walk options]\n");
+    printf("       ./pfind -d <directory> --index <file> [-p <permissions string>]\n");
+    printf("       ./pfind --use-index <file> -p <permissions string> [-0] [--count]\n");
+    printf("       ./pfind -d <directory> -p <permissions string> --watch\n");
 }
 
-void recurse_directory(const char *dir_path, const char *perm_string)
+static struct prune_list prune; // -prune and -exclude-from patterns
+
+static void free_prune(void)
 {
-    DIR *dir = opendir(dir_path);
-    if (dir == NULL)
+    prune_free(&prune);
+}
+
+// Parses a depth (or other count) argument; returns -1 if it is not a non-negative integer
+static int parse_depth(const char *arg)
+{
+    char *end;
+    errno = 0;
+    long value = strtol(arg, &end, 10);
+    if (errno || end == arg || *end != '\0' || value < 0 || value > INT_MAX)
     {
-        fprintf(stderr, "Error: Cannot open directory '%s'.\n", dir_path);
-        return;
+        return -1;
     }
+    return (int)value;
+}
 
-    struct dirent *entry;          // Directory entry structure
-    struct stat file_stat;         // File status structure
-    char full_path_name[PATH_MAX]; // Buffer to hold the full path of the file
-
-    while ((entry = readdir(dir)) != NULL)
+// Walk callback: every match goes to the output buffer, or with -contains
+// to the worker pool that checks its contents (ctx)
+static int print_match(struct pfind_entry *entry, void *ctx)
+{
+    if (ctx)
     {
-        // Skip "." and ".." to avoid infinite recursion
-        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
-        {
-            continue;
-        }
-
-        // Construct the full path of the file/directory
-        snprintf(full_path_name, PATH_MAX, "%s/%s", dir_path, entry->d_name);
-        // full_path_name = malloc(strlen(dir_path) + strlen(entry->d_name) + 2);
-
-        // Use lstat to get file information
-        if (lstat(full_path_name, &file_stat) < 0)
-        {
-            fprintf(stderr, "Error: Cannot stat '%s'.\n", full_path_name);
-            continue;
-        }
-
-        // Check if the file matches the permissions string (From Chapter 4.5)
-        // We can't just get the permissions as a full string directly
-        // so we need to check the file mode bits
-        if (S_ISREG(file_stat.st_mode)) // Only checks regular files (not directories)
-        {
-            char file_perm[10];                                  // Buffer to hold the file permissions string
-            snprintf(file_perm, 10, "%c%c%c%c%c%c%c%c%c",        // Format: drwxrwxrwx
-                     (file_stat.st_mode & S_IRUSR) ? 'r' : '-',  // User read
-                     (file_stat.st_mode & S_IWUSR) ? 'w' : '-',  // User write
-                     (file_stat.st_mode & S_IXUSR) ? 'x' : '-',  // User execute
-                     (file_stat.st_mode & S_IRGRP) ? 'r' : '-',  // Group read
-                     (file_stat.st_mode & S_IWGRP) ? 'w' : '-',  // Group write
-                     (file_stat.st_mode & S_IXGRP) ? 'x' : '-',  // Group execute
-                     (file_stat.st_mode & S_IROTH) ? 'r' : '-',  // Other read
-                     (file_stat.st_mode & S_IWOTH) ? 'w' : '-',  // Other write
-                     (file_stat.st_mode & S_IXOTH) ? 'x' : '-'); // Other execute
-
-            if (strcmp(file_perm, perm_string) == 0) // Compare perm strings
-            {
-                printf("%s\n", full_path_name); // If successful, print the absolute path of the matching file
-            }
-        }
-
-        // If the entry is a directory, recurse into it
-        if (S_ISDIR(file_stat.st_mode))
-        {
-            recurse_directory(full_path_name, perm_string);
-        }
+        return contains_submit(ctx, entry->path, entry->path_len);
     }
+    out_path(entry->path, entry->path_len);
+    return 0;
+}
 
-    closedir(dir);
+// --duplicates callback: every non-empty regular file is a candidate
+static int collect_candidate(struct pfind_entry *entry, void *ctx)
+{
+    const struct stat *st = pfind_stat(entry);
+    if (st == NULL || !S_ISREG(st->st_mode) || st->st_size == 0)
+    {
+        return 0;
+    }
+    return dups_add(ctx, entry->path, entry->path_len, st->st_size);
 }
 
 int main(int argc, char *argv[])
@@ -85,13 +104,149 @@ int main(int argc, char *argv[])
     int opt;                  // variable to store the option character
     char *directory = NULL;   // directory as char pointer (string)
     char *perm_string = NULL; // permissions string as char pointer (string)
+    char *index_file = NULL;  // --index: file to build or refresh
+    char *use_index = NULL;   // --use-index: file to answer the query from
+    int watch = 0;            // --watch: keep reporting matches as the tree changes
+    int nul_terminated = 0;   // -0: end each path with '\0' instead of '\n'
+    int count_only = 0;       // --count: only print the number of matches
+    const char *walk_option = NULL; // First walk-only option given (-L, -maxdepth, ...), for errors
+    struct pfind_options walk;
+    int show_stats = 0;       // --stats: print traversal statistics to stderr at the end
+    unsigned progress = 0;    // --progress: seconds between throughput reports, 0 for none
+    struct walk_stats stats;
+    char *contains = NULL;    // -contains: only report files containing this string
+    int jobs = 0;             // --jobs: -contains/--duplicates threads, 0 for one per CPU
+    int duplicates = 0;       // --duplicates: report groups of identical files
+    double start = stats_now();
+    pfind_options_init(&walk);
+    prune_init(&prune);
+    atexit(free_prune); // Every early return below is then leak-free
+
+    static const struct option long_options[] = {
+        {"index", required_argument, NULL, OPT_INDEX},
+        {"use-index", required_argument, NULL, OPT_USE_INDEX},
+        {"watch", no_argument, NULL, OPT_WATCH},
+        {"count", no_argument, NULL, OPT_COUNT},
+        {"xdev", no_argument, NULL, OPT_XDEV},
+        {"dedup-links", no_argument, NULL, OPT_DEDUP_LINKS},
+        {"maxdepth", required_argument, NULL, OPT_MAXDEPTH},
+        {"mindepth", required_argument, NULL, OPT_MINDEPTH},
+        {"prune", required_argument, NULL, OPT_PRUNE},
+        {"exclude-from", required_argument, NULL, OPT_EXCLUDE_FROM},
+        {"stats", no_argument, NULL, OPT_STATS},
+        {"progress", optional_argument, NULL, OPT_PROGRESS},
+        {"order", required_argument, NULL, OPT_ORDER},
+        {"bfs", no_argument, NULL, OPT_BFS},
+        {"max-open", required_argument, NULL, OPT_MAX_OPEN},
+        {"contains", required_argument, NULL, OPT_CONTAINS},
+        {"jobs", required_argument, NULL, OPT_JOBS},
+        {"duplicates", no_argument, NULL, OPT_DUPLICATES},
+        {NULL, 0, NULL, 0}};
 
-    // Use getopt to process command-line options
-    while ((opt = getopt(argc, argv, "d:p:h")) != -1)
+    // Use getopt to process command-line options (long options may use - or --)
+    while ((opt = getopt_long_only(argc, argv, "d:p:h0L", long_options, NULL)) != -1)
     {
         switch (opt)
         {
-
+        case OPT_INDEX:
+            index_file = optarg;
+            break;
+        case OPT_USE_INDEX:
+            use_index = optarg;
+            break;
+        case OPT_WATCH:
+            watch = 1;
+            break;
+        case OPT_COUNT:
+            count_only = 1;
+            break;
+        case '0':
+            nul_terminated = 1;
+            break;
+        case 'L':
+            walk_option = "-L";
+            walk.follow_links = 1;
+            break;
+        case OPT_XDEV:
+            walk_option = "-xdev";
+            walk.same_fs = 1;
+            break;
+        case OPT_DEDUP_LINKS:
+            walk_option = "--dedup-links";
+            walk.dedup_links = 1;
+            break;
+        case OPT_MAXDEPTH:
+        case OPT_MINDEPTH:
+        {
+            int depth = parse_depth(optarg);
+            if (depth < 0)
+            {
+                fprintf(stderr, "Error: Invalid depth '%s'.\n", optarg);
+                return EXIT_FAILURE;
+            }
+            *(opt == OPT_MAXDEPTH ? &walk.max_depth : &walk.min_depth) = depth;
+            walk_option = opt == OPT_MAXDEPTH ? "-maxdepth" : "-mindepth";
+            break;
+        }
+        case OPT_PRUNE:
+        case OPT_EXCLUDE_FROM:
+            if ((opt == OPT_PRUNE ? prune_add(&prune, optarg) : prune_load(&prune, optarg)) < 0)
+            {
+                return EXIT_FAILURE;
+            }
+            walk.prune = &prune;
+            walk_option = opt == OPT_PRUNE ? "-prune" : "-exclude-from";
+            break;
+        case OPT_STATS:
+            show_stats = 1;
+            break;
+        case OPT_PROGRESS:
+        {
+            int interval = optarg ? parse_depth(optarg) : 1;
+            if (interval <= 0)
+            {
+                fprintf(stderr, "Error: Invalid progress interval '%s'.\n", optarg);
+                return EXIT_FAILURE;
+            }
+            progress = (unsigned)interval;
+            break;
+        }
+        case OPT_ORDER:
+            if (strcmp(optarg, "inode") != 0 && strcmp(optarg, "readdir") != 0)
+            {
+                fprintf(stderr, "Error: Invalid order '%s' (expected readdir or inode).\n", optarg);
+                return EXIT_FAILURE;
+            }
+            walk.inode_order = strcmp(optarg, "inode") == 0;
+            walk_option = "--order";
+            break;
+        case OPT_BFS:
+            walk_option = "--bfs";
+            walk.breadth_first = 1;
+            break;
+        case OPT_MAX_OPEN:
+            walk.max_open = parse_depth(optarg);
+            if (walk.max_open <= 0)
+            {
+                fprintf(stderr, "Error: Invalid directory budget '%s'.\n", optarg);
+                return EXIT_FAILURE;
+            }
+            walk_option = "--max-open";
+            break;
+        case OPT_CONTAINS:
+            contains = optarg;
+            break;
+        case OPT_JOBS:
+            jobs = parse_depth(optarg);
+            if (jobs <= 0)
+            {
+                fprintf(stderr, "Error: Invalid number of jobs '%s'.\n", optarg);
+                return EXIT_FAILURE;
+            }
+            break;
+        case OPT_DUPLICATES:
+            duplicates = 1;
+            break;
         case 'h':
             // If -h is passed, display usage and exit successfully
             print_usage();
@@ -113,44 +268,89 @@ int main(int argc, char *argv[])
         }
     }
 
+    if (index_file != NULL && use_index != NULL)
+    {
+        fprintf(stderr, "Error: --index and --use-index cannot be combined.\n");
+        return EXIT_FAILURE;
+    }
+    if (watch && (index_file != NULL || use_index != NULL))
+    {
+        fprintf(stderr, "Error: --watch cannot be combined with an index.\n");
+        return EXIT_FAILURE;
+    }
+    if (walk_option != NULL && (index_file != NULL || use_index != NULL))
+    {
+        // The index is built from a full walk and queried as a flat list
+        fprintf(stderr, "Error: %s cannot be combined with an index.\n", walk_option);
+        return EXIT_FAILURE;
+    }
+    if (watch && (walk_option != NULL || count_only))
+    {
+        // The watcher scans and watches the whole tree, and never finishes a count
+        fprintf(stderr, "Error: %s cannot be combined with --watch.\n", count_only ? "--count" : walk_option);
+        return EXIT_FAILURE;
+    }
+    if ((show_stats || progress) && (watch || index_file != NULL || use_index != NULL))
+    {
+        fprintf(stderr, "Error: --stats and --progress only apply to a directory walk.\n");
+        return EXIT_FAILURE;
+    }
+    if (contains != NULL && (watch || index_file != NULL || use_index != NULL))
+    {
+        fprintf(stderr, "Error: -contains only applies to a directory walk.\n");
+        return EXIT_FAILURE;
+    }
+    if (duplicates && (contains != NULL || watch || index_file != NULL || use_index != NULL))
+    {
+        fprintf(stderr, "Error: --duplicates cannot be combined with -contains, --watch or an index.\n");
+        return EXIT_FAILURE;
+    }
+    if (use_index != NULL && directory != NULL)
+    {
+        fprintf(stderr, "Error: -d cannot be combined with --use-index.\n");
+        return EXIT_FAILURE;
+    }
+
     // Validate that the program included directory and permissions string
-    if (directory == NULL)
+    // (an index query takes its directory from the index, and building one
+    // or looking for duplicates does not need a permissions string)
+    if (directory == NULL && use_index == NULL)
     {
         fprintf(stderr, "Error: Required argument -d <directory> not found.\n");
         return EXIT_FAILURE;
     }
-    if (perm_string == NULL)
+    if (perm_string == NULL && index_file == NULL && !duplicates)
     {
         fprintf(stderr, "Error: Required argument -p <permissions string> not found.\n");
         return EXIT_FAILURE;
     }
 
-    // Both args should be set — might need further processing/validating?
-    // Next steps: Validate permissions string ✅, check directory existence ✅, etc.
+    if (perm_string == NULL && index_file != NULL)
+    {
+        // Only building an index, nothing to print
+        return index_build(directory, index_file) == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
 
-    // Validate the permissions string using regex (Citation: NLP, OpenGroup and GNU C)
-    regex_t regex;
-    int return_value;
-    // Compile regex pattern:
-    // ^(r|-)(w|-)(x|-)(r|-)(w|-)(x|-)(r|-)(w|-)(x|-)$ --- Could I rewrite this with modulo per 3 characters?
-    // Beginning of string ^, 3 sets of (r|-)(w|-)(x|-), and end of string $
-    // regcomp returns 0 on success, non-zero on failure
-    return_value = regcomp(&regex, "^(r|-)(w|-)(x|-)(r|-)(w|-)(x|-)(r|-)(w|-)(x|-)$", REG_EXTENDED);
-    if (return_value) // Because regcomp returns 0 on success, if(ret) to check for failure
+    // Validate the permissions string: nine characters, each r/w/x or '-'
+    if (perm_string != NULL && !perm_is_valid(perm_string))
     {
-        fprintf(stderr, "Error: Could not compile regex.\n");
+        fprintf(stderr, "Error: Permissions string '%s' is invalid.\n", perm_string);
         return EXIT_FAILURE;
     }
-    // Execute regex compare on the permissions string
-    return_value = regexec(&regex, perm_string, 0, NULL, 0);
-    // &regex is reference to the compiled regex, perm_string is comparing string,
-    // first 0 is for number of matches, NULL is a pointer to store match info, and last 0 is for no execution options
-    regfree(&regex); // Free the compiled regex
-    if (return_value != 0)
+
+    mode_t perm_mode = perm_string ? perm_to_mode(perm_string) : 0;
+    out_init(nul_terminated, count_only);
+
+    // Index modes: build/refresh first if asked, then answer from the index
+    if (index_file != NULL && index_build(directory, index_file) < 0)
     {
-        fprintf(stderr, "Error: Permissions string '%s' is invalid.\n", perm_string);
         return EXIT_FAILURE;
     }
+    if (index_file != NULL || use_index != NULL)
+    {
+        int rc = index_query(index_file ? index_file : use_index, perm_mode);
+        return out_finish() == 0 && rc == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
 
     /// Check if the directory exists and is accessible
     DIR *dir = opendir(directory);
@@ -163,11 +363,88 @@ int main(int argc, char *argv[])
     // If dir != NULL, successfully opened the directory, ergo it exists and is accessible
     closedir(dir);
 
+    if (watch)
+    {
+        watch_run(directory, perm_mode); // Only returns on error
+        return EXIT_FAILURE;
+    }
+
     // Now both arguments have now been validated.
     // Next steps: need to implement recursion and file permission matching.
 
     // Call the recursive function to search for files with the specified permissions
-    recurse_directory(directory, perm_string);
+    walk.perm = perm_string;
+    prune_finish(&prune);
+    if (show_stats || progress)
+    {
+        stats_init(&stats);
+        walk.stats = &stats;
+    }
+    if (progress && stats_progress_start(progress) < 0)
+    {
+        return EXIT_FAILURE;
+    }
+
+    if (jobs == 0)
+    {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        jobs = cpus > 0 ? (int)(cpus < MAX_JOBS ? cpus : MAX_JOBS) : 1;
+    }
+    struct contains_pool *pool = NULL;
+    if (contains != NULL)
+    {
+        pool = contains_start(contains, jobs);
+        if (pool == NULL)
+        {
+            return EXIT_FAILURE;
+        }
+    }
+    struct dups dups;
+    dups_init(&dups);
+    if (duplicates)
+    {
+        // A file reached through several hard links is one file, not duplicates
+        walk.dedup_links = 1;
+    }
+
+    double walk_start = stats_now();
+    int rc = pfind_walk(directory, &walk, duplicates ? collect_candidate : print_match,
+                        duplicates ? (void *)&dups : (void *)pool) == 0
+                 ? EXIT_SUCCESS
+                 : EXIT_FAILURE;
+    // Waits for the last files to be searched. The walk counted every file
+    // it handed to the pool; only those the workers reported are matches.
+    unsigned long long contains_matches = 0;
+    if (pool != NULL && contains_finish(pool, &contains_matches) < 0)
+    {
+        rc = EXIT_FAILURE;
+    }
+    if (pool != NULL && walk.stats)
+    {
+        stats.matches = contains_matches;
+    }
+    if (duplicates && rc == EXIT_SUCCESS && dups_report(&dups, jobs) < 0)
+    {
+        rc = EXIT_FAILURE;
+    }
+    dups_free(&dups);
+    double walk_end = stats_now();
+    if (out_finish() < 0)
+    {
+        rc = EXIT_FAILURE;
+    }
 
-    return EXIT_SUCCESS;
+    if (show_stats)
+    {
+        unsigned long long bytes;
+        double write_seconds;
+        out_totals(&bytes, &write_seconds);
+        stats_print(stderr, &stats, walk_start - start, walk_end - walk_start, stats_now() - walk_end, bytes,
+                    write_seconds);
+    }
+    if (walk.stats)
+    {
+        stats_free(&stats);
+    }
+    return rc;
 }
@@ -0,0 +1,18 @@
+#ifndef PFIND_H
+#define PFIND_H
+
+#include <sys/types.h> // For mode_t
+
+// Permission bits we compare against (rwxrwxrwx, no setuid/sticky)
+#define PERM_MASK 0777
+
+// True if perm_string is nine characters of r/w/x or - in rwxrwxrwx order
+int perm_is_valid(const char *perm_string);
+
+// Converts a validated "rwxr-x---" style string into its mode bits
+mode_t perm_to_mode(const char *perm_string);
+
+// True if the lstat() mode is a regular file with exactly these permissions
+int mode_matches(mode_t st_mode, mode_t perm_mode);
+
+#endif
@@ -0,0 +1,118 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>   // For fopen, getline, fprintf
+#include <stdlib.h>  // For realloc, qsort, bsearch
+#include <string.h>  // For strcmp, strpbrk, strerror
+#include <errno.h>   // For errno
+#include <fnmatch.h> // For fnmatch
+#include "prune.h"
+
+void prune_init(struct prune_list *list)
+{
+    memset(list, 0, sizeof(*list));
+}
+
+void prune_free(struct prune_list *list)
+{
+    for (size_t i = 0; i < list->nexact; i++)
+    {
+        free(list->exact[i]);
+    }
+    for (size_t i = 0; i < list->nglobs; i++)
+    {
+        free(list->globs[i]);
+    }
+    free(list->exact);
+    free(list->globs);
+    prune_init(list);
+}
+
+static int append(char ***items, size_t *count, size_t *cap, const char *pattern)
+{
+    if (*count == *cap)
+    {
+        size_t new_cap = *cap ? *cap * 2 : 16;
+        char **grown = realloc(*items, new_cap * sizeof(char *));
+        if (!grown)
+        {
+            fprintf(stderr, "Error: realloc() failed. %s.\n", strerror(errno));
+            return -1;
+        }
+        *items = grown;
+        *cap = new_cap;
+    }
+    char *copy = strdup(pattern);
+    if (!copy)
+    {
+        fprintf(stderr, "Error: strdup() failed. %s.\n", strerror(errno));
+        return -1;
+    }
+    (*items)[(*count)++] = copy;
+    return 0;
+}
+
+int prune_add(struct prune_list *list, const char *pattern)
+{
+    // Whole-path patterns go through fnmatch() even without glob characters
+    if (strpbrk(pattern, "*?[/"))
+    {
+        return append(&list->globs, &list->nglobs, &list->globs_cap, pattern);
+    }
+    return append(&list->exact, &list->nexact, &list->exact_cap, pattern);
+}
+
+int prune_load(struct prune_list *list, const char *file)
+{
+    FILE *fp = fopen(file, "r");
+    if (!fp)
+    {
+        fprintf(stderr, "Error: Cannot open exclude file '%s'. %s.\n", file, strerror(errno));
+        return -1;
+    }
+
+    char *line = NULL;
+    size_t cap = 0;
+    ssize_t length;
+    int rc = 0;
+    while (rc == 0 && (length = getline(&line, &cap, fp)) != -1)
+    {
+        if (length && line[length - 1] == '\n')
+        {
+            line[--length] = '\0';
+        }
+        if (length && line[0] != '#')
+        {
+            rc = prune_add(list, line);
+        }
+    }
+
+    free(line);
+    fclose(fp);
+    return rc;
+}
+
+static int compare_names(const void *a, const void *b)
+{
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+void prune_finish(struct prune_list *list)
+{
+    qsort(list->exact, list->nexact, sizeof(char *), compare_names);
+}
+
+int prune_match(const struct prune_list *list, const char *name, const char *path)
+{
+    if (list->nexact && bsearch(&name, list->exact, list->nexact, sizeof(char *), compare_names))
+    {
+        return 1;
+    }
+    for (size_t i = 0; i < list->nglobs; i++)
+    {
+        const char *pattern = list->globs[i];
+        if (strchr(pattern, '/') ? fnmatch(pattern, path, FNM_PATHNAME) == 0 : fnmatch(pattern, name, 0) == 0)
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,36 @@
+#ifndef PRUNE_H
+#define PRUNE_H
+
+#include <stddef.h> // For size_t
+
+// Names (or paths) the walk skips without stat()ing or opening them.
+// Plain names are kept sorted and binary searched; patterns with glob
+// characters are tried one by one with fnmatch().
+struct prune_list
+{
+    char **exact;
+    size_t nexact;
+    size_t exact_cap;
+    char **globs;
+    size_t nglobs;
+    size_t globs_cap;
+};
+
+void prune_init(struct prune_list *list);
+void prune_free(struct prune_list *list);
+
+// Adds a pattern. One containing '/' is matched against the whole path,
+// otherwise against the entry name. Returns 0, or -1 on allocation failure.
+int prune_add(struct prune_list *list, const char *pattern);
+
+// Adds every line of file as a pattern, ignoring blank lines and lines
+// starting with '#'. Returns 0, or -1 (an error has been printed).
+int prune_load(struct prune_list *list, const char *file);
+
+// Must be called after the last prune_add()/prune_load() and before matching
+void prune_finish(struct prune_list *list);
+
+// True if the entry called name at path should be skipped
+int prune_match(const struct prune_list *list, const char *name, const char *path);
+
+#endif
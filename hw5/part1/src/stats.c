@@ -0,0 +1,143 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdlib.h>   // For realloc, free
+#include <string.h>   // For memset, strerror
+#include <errno.h>    // For errno
+#include <time.h>     // For clock_gettime
+#include <sys/time.h> // For setitimer
+#include "stats.h"
+
+volatile sig_atomic_t stats_progress_due = 0;
+
+static double progress_start; // When the progress timer was started
+
+void stats_init(struct walk_stats *stats)
+{
+    memset(stats, 0, sizeof(*stats));
+}
+
+void stats_free(struct walk_stats *stats)
+{
+    free(stats->depth_entries);
+    stats_init(stats);
+}
+
+static int grow_depth(struct walk_stats *stats, size_t ndepth)
+{
+    if (ndepth <= stats->ndepth)
+    {
+        return 0;
+    }
+    size_t cap = stats->ndepth ? stats->ndepth : 16;
+    while (cap < ndepth)
+    {
+        cap *= 2;
+    }
+    unsigned long long *grown = realloc(stats->depth_entries, cap * sizeof(*grown));
+    if (!grown)
+    {
+        return -1; // The histogram just stops growing
+    }
+    memset(grown + stats->ndepth, 0, (cap - stats->ndepth) * sizeof(*grown));
+    stats->depth_entries = grown;
+    stats->ndepth = cap;
+    return 0;
+}
+
+void stats_count_depth(struct walk_stats *stats, int depth)
+{
+    if ((size_t)depth < stats->ndepth || grow_depth(stats, (size_t)depth + 1) == 0)
+    {
+        stats->depth_entries[depth]++;
+    }
+}
+
+void stats_count_error(struct walk_stats *stats, int err)
+{
+    stats->errors[err > 0 && err < STATS_ERRNO_MAX ? err : STATS_ERRNO_MAX - 1]++;
+}
+
+double stats_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static void progress_alarm(int sig)
+{
+    (void)sig;
+    stats_progress_due = 1;
+}
+
+int stats_progress_start(unsigned interval)
+{
+    struct sigaction sa;
+    sa.sa_handler = progress_alarm;
+    sa.sa_flags = SA_RESTART; // readdir()/lstat() must not fail with EINTR
+    sigemptyset(&sa.sa_mask);
+    if (sigaction(SIGALRM, &sa, NULL) == -1)
+    {
+        fprintf(stderr, "Error: Cannot register signal handler. %s.\n", strerror(errno));
+        return -1;
+    }
+
+    struct itimerval timer = {.it_interval = {.tv_sec = interval}, .it_value = {.tv_sec = interval}};
+    if (setitimer(ITIMER_REAL, &timer, NULL) == -1)
+    {
+        fprintf(stderr, "Error: Cannot start progress timer. %s.\n", strerror(errno));
+        return -1;
+    }
+    progress_start = stats_now();
+    return 0;
+}
+
+void stats_progress_report(const struct walk_stats *stats)
+{
+    stats_progress_due = 0;
+    double elapsed = stats_now() - progress_start;
+    fprintf(stderr, "pfind: %.0fs, %llu entries in %llu directories, %llu matches, %.0f entries/s\n", elapsed,
+            stats->entries, stats->dirs_opened, stats->matches, elapsed > 0 ? (double)stats->entries / elapsed : 0);
+}
+
+void stats_print(FILE *fp, const struct walk_stats *stats, double setup, double walk, double finish,
+                 unsigned long long output_bytes, double output_seconds)
+{
+    fprintf(fp, "Directories opened:  %llu\n", stats->dirs_opened);
+    fprintf(fp, "Entries seen:        %llu\n", stats->entries);
+    fprintf(fp, "Stat calls issued:   %llu\n", stats->stats_issued);
+    fprintf(fp, "Stat calls skipped:  %llu\n", stats->stats_skipped);
+    fprintf(fp, "Matches:             %llu\n", stats->matches);
+    fprintf(fp, "Output bytes:        %llu\n", output_bytes);
+
+    fprintf(fp, "Time:\n");
+    fprintf(fp, "  total              %.6fs\n", setup + walk + finish);
+    fprintf(fp, "  setup              %.6fs\n", setup);
+    fprintf(fp, "  walk               %.6fs\n", walk);
+    fprintf(fp, "    readdir          %.6fs\n", stats->readdir_seconds);
+    fprintf(fp, "    stat             %.6fs\n", stats->stat_seconds);
+    fprintf(fp, "  finish             %.6fs\n", finish);
+    fprintf(fp, "  output write()     %.6fs\n", output_seconds);
+
+    int any = 0;
+    for (int i = 0; i < STATS_ERRNO_MAX; i++)
+    {
+        if (stats->errors[i])
+        {
+            if (!any)
+            {
+                fprintf(fp, "Errors:\n");
+                any = 1;
+            }
+            fprintf(fp, "  %-18s %llu\n", strerror(i), stats->errors[i]);
+        }
+    }
+
+    fprintf(fp, "Entries by depth:\n");
+    for (size_t i = 1; i < stats->ndepth; i++)
+    {
+        if (stats->depth_entries[i])
+        {
+            fprintf(fp, "  %-18zu %llu\n", i, stats->depth_entries[i]);
+        }
+    }
+}
@@ -0,0 +1,50 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <signal.h> // For sig_atomic_t
+#include <stdio.h>  // For FILE
+
+#define STATS_ERRNO_MAX 256 // errno values at or above this share the last bin
+
+// Counters for one walk
+struct walk_stats
+{
+    unsigned long long dirs_opened;
+    unsigned long long entries;       // Directory entries seen (without . and ..)
+    unsigned long long stats_issued;  // stat()/lstat() calls made
+    unsigned long long stats_skipped; // Entries never stat()ed (pruned, or ruled out by their d_type)
+    unsigned long long matches;
+    unsigned long long errors[STATS_ERRNO_MAX]; // Failed opendir/stat calls by errno
+    double readdir_seconds;           // Time spent in opendir/readdir
+    double stat_seconds;              // Time spent in stat/lstat
+    unsigned long long *depth_entries; // Entries seen at each depth
+    size_t ndepth;
+};
+
+// Set from the SIGALRM handler when a progress line is due
+extern volatile sig_atomic_t stats_progress_due;
+
+void stats_init(struct walk_stats *stats);
+void stats_free(struct walk_stats *stats);
+
+// Counts an entry at depth (the histogram grows as needed)
+void stats_count_depth(struct walk_stats *stats, int depth);
+
+void stats_count_error(struct walk_stats *stats, int err);
+
+// Monotonic clock in seconds
+double stats_now(void);
+
+// Starts a timer that sets stats_progress_due every interval seconds
+int stats_progress_start(unsigned interval);
+
+// Prints a one-line throughput report to stderr and clears stats_progress_due
+void stats_progress_report(const struct walk_stats *stats);
+
+// Prints the full report. setup, walk and finish are the wall times before,
+// during and after the traversal; output_bytes and output_seconds (time
+// inside write(), overlapping the walk) come from the output buffer.
+void stats_print(FILE *fp, const struct walk_stats *stats, double setup, double walk, double finish,
+                 unsigned long long output_bytes, double output_seconds);
+
+#endif
@@ -0,0 +1,731 @@
+#define _DEFAULT_SOURCE // For telldir, seekdir, d_type and DTTOIF
+#include <stdio.h>    // For fprintf, snprintf
+#include <stdlib.h>   // For malloc, realloc, qsort
+#include <string.h>   // For strcmp, strdup
+#include <errno.h>    // For errno
+#include <dirent.h>   // For fdopendir, dirfd and closedir
+#include <fcntl.h>    // For openat and AT_* flags
+#include <unistd.h>   // For close
+#include <sys/stat.h> // For fstatat()
+#include <sys/resource.h> // For getrlimit
+#include "pfind.h"
+#include "libpfind.h"
+#include "idset.h"
+
+// Most directories the breadth-first frontier holds; past this, new
+// subdirectories are walked depth-first so memory stays bounded
+#define WALK_FRONTIER_MAX 65536
+
+// Most directory streams open at once when the caller sets no budget; each
+// holds a kernel fd and a readdir buffer
+#define WALK_MAX_OPEN 64
+// Descriptors left to the rest of the program under RLIMIT_NOFILE
+#define WALK_FD_RESERVE 16
+
+// One buffered directory entry (inode order); name is an offset into the
+// frame's name buffer
+struct inode_entry
+{
+    ino_t ino;
+    size_t name;
+    unsigned char type; // d_type
+};
+
+// One directory being read, innermost last on the walker's stack. Its path
+// is the first path_len bytes of the shared path buffer.
+struct frame
+{
+    DIR *dir;        // NULL while closed for the fd budget
+    struct file_id id; // The directory itself, for cycle checks
+    long pos;        // telldir() position to resume at after a reopen
+    size_t path_len; // Length of this directory's path
+    int depth;       // Depth of the entries inside
+    struct inode_entry *entries; // inode_order: the whole directory, sorted
+    char *names;
+    size_t count, next;
+};
+
+// A directory waiting to be walked breadth-first
+struct queued
+{
+    char *path;
+    int depth;
+    struct file_id id;
+};
+
+// Ring buffer of queued directories
+struct frontier
+{
+    struct queued *items;
+    size_t head, count, cap;
+};
+
+// State of one walk. Memory is the frame stack and the path buffer, both
+// proportional to the depth, plus the breadth-first frontier.
+struct pfind_iter
+{
+    struct pfind_entry entry; // First, so pfind_stat() can find the iterator
+    struct stat st;           // The entry's stat data, once have_stat is set
+    int have_stat;
+    int pending;              // The entry is a directory to descend into next
+    int pending_depth;
+    struct pfind_options opts;
+    mode_t perm_mode;    // opts.perm as mode bits
+    struct frame *stack; // Directories from the root (or a frontier entry) down
+    size_t nframes, frames_cap;
+    char *path;          // Path of the entry being looked at
+    size_t path_cap;
+    int open;            // Directory streams currently open
+    int max_open;        // Budget for open
+    size_t oldest_open;  // No frame below this index has an open stream
+    int track_dirs;     // Remember every directory walked, not just the current ones
+    struct idset dirs;  // Directories already walked (track_dirs)
+    struct idset files; // Multiply-linked files already reported (dedup_links)
+    dev_t root_dev;     // Filesystem of the starting directory (same_fs)
+    struct frontier frontier; // Directories waiting to be walked (breadth_first)
+};
+
+// Returns 1 if the directory is to be walked. With track_dirs that is when
+// it has not been walked yet (it is then marked walked; if the set cannot
+// grow it is walked anyway). Otherwise only the directories being walked
+// are checked, which still stops a cycle through a bind mount.
+static int first_visit(struct pfind_iter *w, const struct stat *st)
+{
+    if (w->track_dirs)
+    {
+        return idset_insert(&w->dirs, st->st_dev, st->st_ino) != 0;
+    }
+    for (size_t i = 0; i < w->nframes; i++)
+    {
+        if (w->stack[i].id.dev == (uint64_t)st->st_dev && w->stack[i].id.ino == (uint64_t)st->st_ino)
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static struct file_id id_of(const struct stat *st)
+{
+    struct file_id id = {(uint64_t)st->st_dev, (uint64_t)st->st_ino};
+    return id;
+}
+
+// Makes room for a path of length len (plus its terminator)
+static int reserve_path(struct pfind_iter *w, size_t len)
+{
+    if (len < w->path_cap)
+    {
+        return 0;
+    }
+    size_t cap = w->path_cap ? w->path_cap : 256;
+    while (cap <= len)
+    {
+        cap *= 2;
+    }
+    char *path = realloc(w->path, cap);
+    if (!path)
+    {
+        fprintf(stderr, "Error: realloc() failed. %s.\n", strerror(errno));
+        return -1;
+    }
+    w->path = path;
+    w->path_cap = cap;
+    return 0;
+}
+
+// Opens the directory at the current path, by name relative to the open
+// directory at (so the kernel does not walk the whole path again), or by
+// the full path with AT_FDCWD. Timed and counted when collecting stats.
+static DIR *open_dir(struct pfind_iter *w, int at, const char *name)
+{
+    struct walk_stats *stats = w->opts.stats;
+    double start = stats ? stats_now() : 0;
+    int fd = openat(at, name, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    DIR *dir = fd < 0 ? NULL : fdopendir(fd);
+    if (fd >= 0 && dir == NULL)
+    {
+        int err = errno;
+        close(fd);
+        errno = err;
+    }
+    if (stats)
+    {
+        stats->readdir_seconds += stats_now() - start;
+        if (dir == NULL)
+        {
+            stats_count_error(stats, errno);
+        }
+        else
+        {
+            stats->dirs_opened++;
+        }
+    }
+    if (dir == NULL)
+    {
+        fprintf(stderr, "Error: Cannot open directory '%s'. %s.\n", w->path, strerror(errno));
+    }
+    return dir;
+}
+
+// readdir() that tells the end of a directory apart from a read error,
+// skips . and .., and accounts its time when stats are being collected
+static struct dirent *next_entry(struct pfind_iter *w, DIR *dir)
+{
+    struct walk_stats *stats = w->opts.stats;
+    double start = stats ? stats_now() : 0;
+    struct dirent *entry;
+    do
+    {
+        errno = 0;
+        entry = readdir(dir);
+    } while (entry && (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0));
+    int err = errno;
+    if (stats)
+    {
+        stats->readdir_seconds += stats_now() - start;
+    }
+    if (!entry && err)
+    {
+        // Whatever was read so far has been handled; the rest is lost
+        if (stats)
+        {
+            stats_count_error(stats, err);
+        }
+        fprintf(stderr, "Error: Cannot read directory '%s'. %s.\n", w->path, strerror(err));
+    }
+    return entry;
+}
+
+// Closes the stream of the outermost frame that still has one, remembering
+// where to resume, so that a new directory can be opened within the budget
+static void release_oldest(struct pfind_iter *w)
+{
+    while (w->oldest_open < w->nframes && !w->stack[w->oldest_open].dir)
+    {
+        w->oldest_open++;
+    }
+    if (w->oldest_open == w->nframes)
+    {
+        return;
+    }
+    struct frame *f = &w->stack[w->oldest_open];
+    f->pos = telldir(f->dir);
+    closedir(f->dir);
+    f->dir = NULL;
+    w->open--;
+}
+
+// Use lstat to get file information; with follow_links use stat, and fall
+// back to lstat for a dangling link. name is relative to the directory at,
+// as for open_dir(). Counts calls, time and errors.
+static int stat_entry(struct pfind_iter *w, int at, const char *name, struct stat *file_stat)
+{
+    struct walk_stats *stats = w->opts.stats;
+    double start = stats ? stats_now() : 0;
+    int rc = -1, calls = 0;
+    if (w->opts.follow_links)
+    {
+        calls++;
+        rc = fstatat(at, name, file_stat, 0);
+    }
+    if (rc < 0)
+    {
+        calls++;
+        rc = fstatat(at, name, file_stat, AT_SYMLINK_NOFOLLOW);
+    }
+    if (stats)
+    {
+        stats->stat_seconds += stats_now() - start;
+        stats->stats_issued += (unsigned long long)calls;
+        if (rc < 0)
+        {
+            stats_count_error(stats, errno);
+        }
+    }
+    return rc;
+}
+
+static void push_directory(struct pfind_iter *w, size_t path_len, int depth, struct file_id id);
+
+// Hands a subdirectory (the current path, with identity id) on: pushed to
+// be walked next when depth-first (or when the breadth-first frontier is
+// full), queued otherwise
+static void descend(struct pfind_iter *w, size_t path_len, int depth, struct file_id id)
+{
+    struct frontier *q = &w->frontier;
+    if (!w->opts.breadth_first || q->count == WALK_FRONTIER_MAX)
+    {
+        push_directory(w, path_len, depth, id);
+        return;
+    }
+    if (q->count == q->cap)
+    {
+        size_t cap = q->cap ? q->cap * 2 : 64;
+        struct queued *items = malloc(cap * sizeof(*items));
+        if (!items)
+        {
+            fprintf(stderr, "Error: malloc() failed. %s.\n", strerror(errno));
+            push_directory(w, path_len, depth, id);
+            return;
+        }
+        // Unwrap the ring into the new array
+        for (size_t i = 0; i < q->count; i++)
+        {
+            items[i] = q->items[(q->head + i) % q->cap];
+        }
+        free(q->items);
+        q->items = items;
+        q->head = 0;
+        q->cap = cap;
+    }
+    char *copy = strdup(w->path);
+    if (!copy)
+    {
+        fprintf(stderr, "Error: strdup() failed. %s.\n", strerror(errno));
+        push_directory(w, path_len, depth, id);
+        return;
+    }
+    struct queued *slot = &q->items[(q->head + q->count) % q->cap];
+    slot->path = copy;
+    slot->depth = depth;
+    slot->id = id;
+    q->count++;
+}
+
+// stat()s the current entry into the iterator, reporting failures. The
+// entry is in the innermost directory, stat()ed by name if that is open.
+static int stat_current(struct pfind_iter *w)
+{
+    const struct frame *f = &w->stack[w->nframes - 1];
+    int at = f->dir ? dirfd(f->dir) : AT_FDCWD;
+    if (stat_entry(w, at, f->dir ? w->entry.name : w->path, &w->st) < 0)
+    {
+        fprintf(stderr, "Error: Cannot stat '%s'. %s.\n", w->path, strerror(errno));
+        return -1;
+    }
+    w->have_stat = 1;
+    w->entry.type = w->st.st_mode & S_IFMT;
+    return 0;
+}
+
+// Handles one entry of the innermost directory: prune check, predicates,
+// and noting a directory to descend into. Returns 1 if the entry is
+// reported. Entries whose readdir() type already rules them out, and that
+// no predicate needs to look at, are never stat()ed.
+static int visit_entry(struct pfind_iter *w, const char *name, unsigned char d_type)
+{
+    const struct pfind_options *opts = &w->opts;
+    struct walk_stats *stats = opts->stats;
+    size_t dir_len = w->stack[w->nframes - 1].path_len;
+    int depth = w->stack[w->nframes - 1].depth;
+
+    if (stats)
+    {
+        stats->entries++;
+        stats_count_depth(stats, depth);
+        if (stats_progress_due)
+        {
+            stats_progress_report(stats);
+        }
+    }
+
+    // Construct the full path of the file/directory after its parent's
+    size_t name_len = strlen(name);
+    size_t path_length = dir_len + 1 + name_len;
+    if (reserve_path(w, path_length) < 0)
+    {
+        return 0;
+    }
+    w->path[dir_len] = '/';
+    memcpy(w->path + dir_len + 1, name, name_len + 1);
+
+    // Pruned names are dropped here, before any stat() or opendir()
+    if (opts->prune && prune_match(opts->prune, name, w->path))
+    {
+        if (stats)
+        {
+            stats->stats_skipped++;
+        }
+        return 0;
+    }
+
+    w->entry.path = w->path;
+    w->entry.path_len = path_length;
+    w->entry.name = w->path + dir_len + 1;
+    w->entry.depth = depth;
+    w->entry.type = DTTOIF(d_type); // 0 for DT_UNKNOWN
+    w->have_stat = 0;
+
+    mode_t type = w->entry.type;
+    int need_stat = type == 0 || (S_ISDIR(type) && depth != opts->max_depth) ||
+                    (S_ISLNK(type) && opts->follow_links) || (S_ISREG(type) && opts->perm) ||
+                    (!S_ISDIR(type) && opts->dedup_links);
+    if (need_stat)
+    {
+        if (stat_current(w) < 0)
+        {
+            return 0;
+        }
+        type = w->entry.type;
+    }
+    else if (stats)
+    {
+        stats->stats_skipped++;
+    }
+
+    // Check if the file matches the permissions string (From Chapter 4.5)
+    // The string was turned into mode bits once, so this is a mask and
+    // compare instead of formatting a string per file
+    int match = depth >= opts->min_depth && (!opts->perm || (w->have_stat && mode_matches(w->st.st_mode, w->perm_mode))) &&
+                (!opts->dedup_links || S_ISDIR(type) || w->st.st_nlink < 2 ||
+                 idset_insert(&w->files, w->st.st_dev, w->st.st_ino) != 0);
+
+    // If the entry is a directory, walk it next, unless it is on another
+    // filesystem (same_fs) or would loop back to a directory being walked
+    // (or, where first_visit() tracks them all, one already walked)
+    if (w->have_stat && S_ISDIR(type) && depth != opts->max_depth &&
+        (!opts->same_fs || w->st.st_dev == w->root_dev) && first_visit(w, &w->st))
+    {
+        w->pending = 1;
+        w->pending_depth = depth + 1;
+    }
+
+    if (match && stats)
+    {
+        stats->matches++;
+    }
+    return match;
+}
+
+static int compare_inodes(const void *a, const void *b)
+{
+    const struct inode_entry *ea = a, *eb = b;
+    return (ea->ino > eb->ino) - (ea->ino < eb->ino);
+}
+
+// Reads the whole directory into the frame, so its entries can be
+// stat()ed in inode order: the inode table is then read forwards instead
+// of seeking around it. The stream stays open for fstatat().
+static void read_by_inode(struct pfind_iter *w, struct frame *f)
+{
+    size_t cap = 0, used = 0, names_cap = 0;
+    struct dirent *entry;
+
+    while ((entry = next_entry(w, f->dir)) != NULL)
+    {
+        size_t len = strlen(entry->d_name) + 1;
+        if (f->count == cap || used + len > names_cap)
+        {
+            size_t new_cap = f->count == cap ? (cap ? cap * 2 : 64) : cap;
+            size_t new_names = names_cap;
+            while (used + len > new_names)
+            {
+                new_names = new_names ? new_names * 2 : 4096;
+            }
+            struct inode_entry *grown = realloc(f->entries, new_cap * sizeof(*f->entries));
+            char *grown_names = grown ? realloc(f->names, new_names) : NULL;
+            if (grown)
+            {
+                f->entries = grown;
+                cap = new_cap;
+            }
+            if (!grown_names)
+            {
+                fprintf(stderr, "Error: realloc() failed. %s.\n", strerror(errno));
+                break;
+            }
+            f->names = grown_names;
+            names_cap = new_names;
+        }
+        f->entries[f->count].ino = entry->d_ino;
+        f->entries[f->count].type = entry->d_type;
+        f->entries[f->count].name = used;
+        memcpy(f->names + used, entry->d_name, len);
+        used += len;
+        f->count++;
+    }
+
+    qsort(f->entries, f->count, sizeof(*f->entries), compare_inodes);
+}
+
+// Opens the directory at the current path (path_len long, identity id)
+// and makes it the innermost frame: a subdirectory relative to its parent,
+// the innermost frame, if that is still open. Failures are reported and
+// the directory is skipped.
+static void push_directory(struct pfind_iter *w, size_t path_len, int depth, struct file_id id)
+{
+    if (w->nframes == w->frames_cap)
+    {
+        size_t cap = w->frames_cap ? w->frames_cap * 2 : 32;
+        struct frame *stack = realloc(w->stack, cap * sizeof(*stack));
+        if (!stack)
+        {
+            fprintf(stderr, "Error: realloc() failed. %s.\n", strerror(errno));
+            return;
+        }
+        w->stack = stack;
+        w->frames_cap = cap;
+    }
+    if (w->open == w->max_open)
+    {
+        release_oldest(w);
+    }
+
+    const struct frame *parent = w->nframes ? &w->stack[w->nframes - 1] : NULL;
+    DIR *dir = parent && parent->dir ? open_dir(w, dirfd(parent->dir), w->path + parent->path_len + 1)
+                                     : open_dir(w, AT_FDCWD, w->path);
+    if (dir == NULL)
+    {
+        return;
+    }
+    w->open++;
+
+    struct frame *f = &w->stack[w->nframes++];
+    memset(f, 0, sizeof(*f));
+    f->dir = dir;
+    f->id = id;
+    f->path_len = path_len;
+    f->depth = depth;
+    if (w->opts.inode_order)
+    {
+        read_by_inode(w, f);
+    }
+}
+
+// Next entry name (and its d_type) of the innermost frame, reopening its
+// stream if the budget closed it; NULL once the directory is done
+static const char *next_name(struct pfind_iter *w, struct frame *f, unsigned char *type)
+{
+    if (w->opts.inode_order && f->next == f->count)
+    {
+        return NULL;
+    }
+    if (!f->dir)
+    {
+        // Reopen by position: telldir() cookies are directory offsets,
+        // which stay valid across opendir() calls on Linux filesystems.
+        // An inode-order frame wants the stream only for fstatat(), and
+        // without it stats its entries by full path.
+        w->path[f->path_len] = '\0';
+        if (w->open == w->max_open)
+        {
+            release_oldest(w);
+        }
+        f->dir = open_dir(w, AT_FDCWD, w->path);
+        if (f->dir)
+        {
+            w->open++;
+            seekdir(f->dir, f->pos);
+        }
+        else if (!w->opts.inode_order)
+        {
+            return NULL;
+        }
+    }
+    if (w->opts.inode_order)
+    {
+        *type = f->entries[f->next].type;
+        return f->names + f->entries[f->next++].name;
+    }
+    w->path[f->path_len] = '\0'; // For error messages
+    struct dirent *entry = next_entry(w, f->dir);
+    if (!entry)
+    {
+        closedir(f->dir);
+        f->dir = NULL;
+        w->open--;
+        return NULL;
+    }
+    *type = entry->d_type;
+    return entry->d_name;
+}
+
+// Pops the innermost frame
+static void pop_frame(struct pfind_iter *w)
+{
+    struct frame *f = &w->stack[--w->nframes];
+    if (f->dir)
+    {
+        closedir(f->dir);
+        w->open--;
+    }
+    free(f->entries);
+    free(f->names);
+    // The new innermost frame may have to reopen its stream
+    if (w->oldest_open >= w->nframes)
+    {
+        w->oldest_open = w->nframes ? w->nframes - 1 : 0;
+    }
+}
+
+// Starts on the next directory of the breadth-first frontier; 0 if none
+static int next_queued(struct pfind_iter *w)
+{
+    struct frontier *q = &w->frontier;
+    if (q->count == 0)
+    {
+        return 0;
+    }
+    struct queued next = q->items[q->head];
+    q->head = (q->head + 1) % q->cap;
+    q->count--;
+    size_t len = strlen(next.path);
+    if (reserve_path(w, len) == 0)
+    {
+        memcpy(w->path, next.path, len + 1);
+        push_directory(w, len, next.depth, next.id);
+    }
+    free(next.path);
+    return 1;
+}
+
+// Runs the frame stack until an entry is reported. The depth-first order
+// is the same as recursion would give: a subdirectory is finished before
+// the next entry of its parent is read.
+struct pfind_entry *pfind_next(struct pfind_iter *w)
+{
+    for (;;)
+    {
+        // Descending is left until the caller is done with the entry,
+        // since it may reuse the path buffer
+        if (w->pending)
+        {
+            w->pending = 0;
+            descend(w, w->entry.path_len, w->pending_depth, id_of(&w->st));
+        }
+        if (w->nframes == 0)
+        {
+            if (!next_queued(w))
+            {
+                return NULL;
+            }
+            continue;
+        }
+
+        unsigned char type;
+        const char *name = next_name(w, &w->stack[w->nframes - 1], &type);
+        if (!name)
+        {
+            pop_frame(w);
+        }
+        else if (visit_entry(w, name, type))
+        {
+            return &w->entry;
+        }
+    }
+}
+
+const struct stat *pfind_stat(struct pfind_entry *entry)
+{
+    struct pfind_iter *w = (struct pfind_iter *)entry;
+    if (!w->have_stat && stat_current(w) < 0)
+    {
+        return NULL;
+    }
+    return &w->st;
+}
+
+// Directory streams this walk may keep open: the caller's budget or
+// WALK_MAX_OPEN, but never more than RLIMIT_NOFILE leaves room for
+static int open_budget(const struct pfind_options *opts)
+{
+    long budget = opts->max_open > 0 ? opts->max_open : WALK_MAX_OPEN;
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur != RLIM_INFINITY &&
+        (rlim_t)budget + WALK_FD_RESERVE > limit.rlim_cur)
+    {
+        budget = limit.rlim_cur > WALK_FD_RESERVE ? (long)(limit.rlim_cur - WALK_FD_RESERVE) : 1;
+    }
+    return (int)budget;
+}
+
+void pfind_options_init(struct pfind_options *opts)
+{
+    memset(opts, 0, sizeof(*opts));
+    opts->max_depth = PFIND_UNLIMITED;
+}
+
+struct pfind_iter *pfind_open(const char *dir_path, const struct pfind_options *opts)
+{
+    if (opts->perm && !perm_is_valid(opts->perm))
+    {
+        fprintf(stderr, "Error: Permissions string '%s' is invalid.\n", opts->perm);
+        return NULL;
+    }
+
+    // The root is followed even without follow_links, as opendir() does
+    struct stat root_stat;
+    if (stat(dir_path, &root_stat) < 0)
+    {
+        fprintf(stderr, "Error: Cannot stat '%s'. %s.\n", dir_path, strerror(errno));
+        return NULL;
+    }
+
+    struct pfind_iter *w = calloc(1, sizeof(*w));
+    if (!w)
+    {
+        fprintf(stderr, "Error: calloc() failed. %s.\n", strerror(errno));
+        return NULL;
+    }
+    w->opts = *opts;
+    w->perm_mode = opts->perm ? perm_to_mode(opts->perm) : 0;
+    w->max_open = open_budget(opts);
+    // Every directory is remembered only where a directory reached twice
+    // would otherwise be reported twice (follow_links, dedup_links) or the
+    // frontier breaks the chain of parents first_visit() checks
+    w->track_dirs = opts->follow_links || opts->dedup_links || opts->breadth_first;
+    idset_init(&w->dirs);
+    idset_init(&w->files);
+    w->root_dev = root_stat.st_dev;
+    first_visit(w, &root_stat);
+
+    size_t root_len = strlen(dir_path);
+    if (opts->max_depth != 0 && reserve_path(w, root_len) == 0)
+    {
+        memcpy(w->path, dir_path, root_len + 1);
+        push_directory(w, root_len, 1, id_of(&root_stat));
+    }
+    return w;
+}
+
+void pfind_close(struct pfind_iter *w)
+{
+    if (!w)
+    {
+        return;
+    }
+    while (w->nframes > 0)
+    {
+        pop_frame(w);
+    }
+    struct frontier *q = &w->frontier;
+    for (; q->count > 0; q->count--)
+    {
+        free(q->items[q->head].path);
+        q->head = (q->head + 1) % q->cap;
+    }
+    free(q->items);
+    free(w->stack);
+    free(w->path);
+    idset_free(&w->dirs);
+    idset_free(&w->files);
+    free(w);
+}
+
+int pfind_walk(const char *dir_path, const struct pfind_options *opts, pfind_fn fn, void *ctx)
+{
+    struct pfind_iter *w = pfind_open(dir_path, opts);
+    if (!w)
+    {
+        return -1;
+    }
+    struct pfind_entry *entry;
+    int rc = 0;
+    while (rc == 0 && (entry = pfind_next(w)) != NULL)
+    {
+        rc = fn(entry, ctx);
+    }
+    pfind_close(w);
+    return rc;
+}
@@ -0,0 +1,386 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>       // For fprintf
+#include <stdlib.h>      // For malloc, realloc, qsort
+#include <stdint.h>      // For uint32_t
+#include <string.h>      // For strcmp, strerror
+#include <errno.h>       // For errno
+#include <limits.h>      // For PATH_MAX
+#include <dirent.h>      // For opendir, readdir
+#include <poll.h>        // For poll
+#include <unistd.h>      // For read, close
+#include <sys/stat.h>    // For lstat
+#include <sys/inotify.h> // For inotify_init1, inotify_add_watch
+#include "pfind.h"
+#include "watch.h"
+#include "out.h"
+
+#define WATCH_MASK (IN_CREATE | IN_ATTRIB | IN_MOVED_TO | IN_MOVE_SELF | IN_ONLYDIR | IN_DONT_FOLLOW | IN_EXCL_UNLINK)
+#define EVENT_BUFFER (256 * 1024) // Bytes of queued events handled as one batch
+#define COALESCE_MS 20            // How long to wait for more events before handling a batch
+
+// One change to look at, after duplicates in a batch have been merged
+struct pending
+{
+    int wd;
+    uint32_t mask;
+    const char *name; // Points into the event buffer
+};
+
+struct watcher
+{
+    int fd;
+    const char *root;
+    mode_t perm_mode;
+    char **paths;         // Directory path of each watch descriptor, NULL if unused
+    unsigned *moved;      // Batch in which the directory reported IN_MOVE_SELF
+    unsigned *seen;       // Batch in which the directory was last (re)added
+    size_t nwd;           // Size of paths, moved and seen
+    unsigned batch;       // Current batch number, starts at 1
+    size_t unwatched;     // Directories skipped after the watch limit was hit
+    int limit_reported;   // Whether the watch limit warning was printed
+};
+
+static int set_path(struct watcher *w, int wd, const char *path)
+{
+    if ((size_t)wd >= w->nwd)
+    {
+        size_t n = w->nwd ? w->nwd : 64;
+        while (n <= (size_t)wd)
+        {
+            n *= 2;
+        }
+        char **paths = realloc(w->paths, n * sizeof(*paths));
+        if (!paths)
+        {
+            fprintf(stderr, "Error: realloc() failed. %s.\n", strerror(errno));
+            return -1;
+        }
+        w->paths = paths;
+        unsigned *moved = realloc(w->moved, n * sizeof(*moved));
+        if (!moved)
+        {
+            fprintf(stderr, "Error: realloc() failed. %s.\n", strerror(errno));
+            return -1;
+        }
+        w->moved = moved;
+        unsigned *seen = realloc(w->seen, n * sizeof(*seen));
+        if (!seen)
+        {
+            fprintf(stderr, "Error: realloc() failed. %s.\n", strerror(errno));
+            return -1;
+        }
+        w->seen = seen;
+        for (size_t i = w->nwd; i < n; i++)
+        {
+            w->paths[i] = NULL;
+            w->moved[i] = 0;
+            w->seen[i] = 0;
+        }
+        w->nwd = n;
+    }
+
+    char *copy = strdup(path);
+    if (!copy)
+    {
+        fprintf(stderr, "Error: strdup() failed. %s.\n", strerror(errno));
+        return -1;
+    }
+    free(w->paths[wd]); // A directory moved inside the tree keeps its watch
+    w->paths[wd] = copy;
+    w->seen[wd] = w->batch;
+    return 0;
+}
+
+static void drop_path(struct watcher *w, int wd)
+{
+    if (wd >= 0 && (size_t)wd < w->nwd)
+    {
+        free(w->paths[wd]);
+        w->paths[wd] = NULL;
+    }
+}
+
+// Watches dir_path and everything below it, printing matching files on the way.
+// Re-adding a directory that is already watched only updates its path.
+static int add_tree(struct watcher *w, const char *dir_path)
+{
+    int wd = inotify_add_watch(w->fd, dir_path, WATCH_MASK);
+    if (wd < 0)
+    {
+        if (errno == ENOSPC)
+        {
+            // Keep scanning so matches are still reported, just not watched
+            if (!w->limit_reported)
+            {
+                fprintf(stderr, "Warning: inotify watch limit reached at '%s'; raise "
+                                "fs.inotify.max_user_watches to watch the rest of the tree.\n",
+                        dir_path);
+                w->limit_reported = 1;
+            }
+            w->unwatched++;
+        }
+        else if (errno != ENOENT && errno != ENOTDIR) // Raced with a delete or rename
+        {
+            fprintf(stderr, "Error: Cannot watch '%s'. %s.\n", dir_path, strerror(errno));
+        }
+    }
+    else if (set_path(w, wd, dir_path) < 0)
+    {
+        return -1;
+    }
+
+    DIR *dir = opendir(dir_path);
+    if (dir == NULL)
+    {
+        fprintf(stderr, "Error: Cannot open directory '%s'.\n", dir_path);
+        return 0;
+    }
+
+    struct dirent *entry;
+    struct stat file_stat;
+    char full_path_name[PATH_MAX];
+    while ((entry = readdir(dir)) != NULL)
+    {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
+        {
+            continue;
+        }
+        int path_length = snprintf(full_path_name, PATH_MAX, "%s/%s", dir_path, entry->d_name);
+        if (path_length >= PATH_MAX)
+        {
+            fprintf(stderr, "Error: Path too long '%s/%s'.\n", dir_path, entry->d_name);
+            continue;
+        }
+        if (lstat(full_path_name, &file_stat) < 0)
+        {
+            fprintf(stderr, "Error: Cannot stat '%s'.\n", full_path_name);
+            continue;
+        }
+
+        if (mode_matches(file_stat.st_mode, w->perm_mode))
+        {
+            out_path(full_path_name, (size_t)path_length);
+        }
+        if (S_ISDIR(file_stat.st_mode) && add_tree(w, full_path_name) < 0)
+        {
+            closedir(dir);
+            return -1;
+        }
+    }
+
+    closedir(dir);
+    return 0;
+}
+
+static int compare_pending(const void *a, const void *b)
+{
+    const struct pending *pa = a, *pb = b;
+    if (pa->wd != pb->wd)
+    {
+        return pa->wd < pb->wd ? -1 : 1;
+    }
+    return strcmp(pa->name, pb->name);
+}
+
+// Looks at one coalesced change: a new directory is scanned and watched,
+// a regular file is printed if it now matches
+static int handle_change(struct watcher *w, const struct pending *change)
+{
+    char full_path_name[PATH_MAX];
+    int path_length = snprintf(full_path_name, PATH_MAX, "%s/%s", w->paths[change->wd], change->name);
+    if (path_length >= PATH_MAX)
+    {
+        fprintf(stderr, "Error: Path too long '%s/%s'.\n", w->paths[change->wd], change->name);
+        return 0;
+    }
+
+    struct stat file_stat;
+    if (lstat(full_path_name, &file_stat) < 0)
+    {
+        return 0; // Already gone again; nothing to report
+    }
+
+    if (S_ISDIR(file_stat.st_mode))
+    {
+        // Only new or moved-in directories need a (re)scan; a chmod of an
+        // already watched directory changes nothing we report
+        return (change->mask & (IN_CREATE | IN_MOVED_TO)) ? add_tree(w, full_path_name) : 0;
+    }
+    if (mode_matches(file_stat.st_mode, w->perm_mode))
+    {
+        out_path(full_path_name, (size_t)path_length);
+    }
+    return 0;
+}
+
+// Handles one batch of raw events: self events update the watch table, the
+// rest are merged per (directory, name) so a burst of events on one file
+// costs one lstat
+static int handle_batch(struct watcher *w, char *buffer, size_t length)
+{
+    size_t max = length / sizeof(struct inotify_event) + 1;
+    struct pending *changes = malloc(max * sizeof(*changes));
+    if (!changes)
+    {
+        fprintf(stderr, "Error: malloc() failed. %s.\n", strerror(errno));
+        return -1;
+    }
+
+    size_t n = 0;
+    int overflow = 0;
+    for (size_t off = 0; off < length;)
+    {
+        struct inotify_event *ev = (struct inotify_event *)(buffer + off);
+        off += sizeof(*ev) + ev->len;
+
+        if (ev->mask & IN_Q_OVERFLOW)
+        {
+            overflow = 1;
+        }
+        else if (ev->mask & IN_IGNORED)
+        {
+            drop_path(w, ev->wd); // Directory deleted or unmounted
+        }
+        else if (ev->mask & IN_MOVE_SELF)
+        {
+            if (ev->wd >= 0 && (size_t)ev->wd < w->nwd)
+            {
+                w->moved[ev->wd] = w->batch;
+            }
+        }
+        else if (ev->len > 0 && ev->wd >= 0 && (size_t)ev->wd < w->nwd && w->paths[ev->wd])
+        {
+            changes[n].wd = ev->wd;
+            changes[n].mask = ev->mask;
+            changes[n].name = ev->name;
+            n++;
+        }
+    }
+
+    int rc = 0;
+    if (overflow)
+    {
+        // Events were lost, so the only safe answer is a full rescan
+        fprintf(stderr, "Warning: inotify queue overflowed; rescanning '%s'.\n", w->root);
+        rc = add_tree(w, w->root);
+    }
+    else
+    {
+        qsort(changes, n, sizeof(*changes), compare_pending);
+        for (size_t i = 0; i < n && rc == 0; i++)
+        {
+            struct pending merged = changes[i];
+            while (i + 1 < n && compare_pending(&changes[i + 1], &merged) == 0)
+            {
+                merged.mask |= changes[++i].mask;
+            }
+            if (w->paths[merged.wd]) // The directory may have gone earlier in the batch
+            {
+                rc = handle_change(w, &merged);
+            }
+        }
+    }
+
+    // A directory that moved away and was not re-added at a new path inside
+    // the tree has left it; stop watching it
+    for (size_t wd = 0; wd < w->nwd; wd++)
+    {
+        if (w->paths[wd] && w->moved[wd] == w->batch && w->seen[wd] != w->batch)
+        {
+            inotify_rm_watch(w->fd, (int)wd);
+            drop_path(w, (int)wd);
+        }
+    }
+
+    free(changes);
+    // Consumers should see matches as soon as a batch is done
+    return out_flush() < 0 ? -1 : rc;
+}
+
+// Reads whatever events are queued, waiting up to COALESCE_MS for more so
+// that bursts are handled as one batch
+static ssize_t read_batch(int fd, char *buffer)
+{
+    ssize_t length = read(fd, buffer, EVENT_BUFFER);
+    if (length <= 0)
+    {
+        return length;
+    }
+
+    struct pollfd pfd = {.fd = fd, .events = POLLIN};
+    // Leave room for at least one maximal event per read()
+    while ((size_t)length + sizeof(struct inotify_event) + NAME_MAX + 1 <= EVENT_BUFFER &&
+           poll(&pfd, 1, COALESCE_MS) > 0)
+    {
+        ssize_t more = read(fd, buffer + length, EVENT_BUFFER - (size_t)length);
+        if (more <= 0)
+        {
+            break;
+        }
+        length += more;
+    }
+    return length;
+}
+
+int watch_run(const char *root_dir, mode_t perm_mode)
+{
+    struct watcher w;
+    memset(&w, 0, sizeof(w));
+    w.root = root_dir;
+    w.perm_mode = perm_mode;
+    w.batch = 1;
+
+    w.fd = inotify_init1(IN_CLOEXEC);
+    if (w.fd < 0)
+    {
+        fprintf(stderr, "Error: inotify_init1() failed. %s.\n", strerror(errno));
+        return -1;
+    }
+
+    // Watches are added before each directory is read, so nothing created
+    // during the initial scan is missed (it may be reported twice instead)
+    int rc = add_tree(&w, root_dir);
+    if (out_flush() < 0)
+    {
+        rc = -1;
+    }
+    if (rc == 0 && w.unwatched)
+    {
+        fprintf(stderr, "Warning: %zu directories are not being watched.\n", w.unwatched);
+    }
+
+    char *buffer = malloc(EVENT_BUFFER);
+    if (!buffer)
+    {
+        fprintf(stderr, "Error: malloc() failed. %s.\n", strerror(errno));
+        rc = -1;
+    }
+
+    while (rc == 0)
+    {
+        ssize_t length = read_batch(w.fd, buffer);
+        if (length < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            fprintf(stderr, "Error: Cannot read inotify events. %s.\n", strerror(errno));
+            rc = -1;
+            break;
+        }
+        w.batch++;
+        rc = handle_batch(&w, buffer, (size_t)length);
+    }
+
+    free(buffer);
+    for (size_t wd = 0; wd < w.nwd; wd++)
+    {
+        free(w.paths[wd]);
+    }
+    free(w.paths);
+    free(w.moved);
+    free(w.seen);
+    close(w.fd);
+    return -1;
+}
@@ -0,0 +1,12 @@
+#ifndef WATCH_H
+#define WATCH_H
+
+#include <sys/types.h> // For mode_t
+
+// Scans root_dir once, printing regular files whose permissions equal
+// perm_mode, then keeps watching the tree with inotify and prints files that
+// are created, chmod'ed or moved in with those permissions. Only returns on
+// error (an error has been printed), with -1.
+int watch_run(const char *root_dir, mode_t perm_mode);
+
+#endif
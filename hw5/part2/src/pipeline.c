@@ -0,0 +1,197 @@
+#define _GNU_SOURCE    // For pipe2, F_SETPIPE_SZ and wait4
+#include <stdio.h>     // For fprintf
+#include <stdlib.h>    // For calloc, free
+#include <string.h>    // For strcmp, strerror
+#include <errno.h>     // For errno
+#include <fcntl.h>     // For pipe2, fcntl
+#include <spawn.h>     // For posix_spawnp
+#include <time.h>      // For clock_gettime
+#include <unistd.h>    // For close
+#include <sys/wait.h>  // For wait4
+#include <sys/resource.h> // For struct rusage
+#include "pipeline.h"
+
+extern char **environ;
+
+struct stage
+{
+    char **argv;   // Points into the caller's args, NULL-terminated in place
+    pid_t pid;     // 0 if it could not be started
+    int status;    // From wait4()
+    struct rusage usage;
+    double start;  // When it was spawned
+    double end;    // When it was reaped
+};
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static double seconds(struct timeval tv)
+{
+    return (double)tv.tv_sec + (double)tv.tv_usec / 1e6;
+}
+
+// Starts one stage reading from in and writing to out (-1 to inherit ours).
+// Every pipe end is close-on-exec, so the child keeps only these two.
+static int spawn_stage(struct stage *stage, int in, int out)
+{
+    posix_spawn_file_actions_t actions;
+    int err = posix_spawn_file_actions_init(&actions);
+    if (!err && in >= 0)
+    {
+        err = posix_spawn_file_actions_adddup2(&actions, in, STDIN_FILENO);
+    }
+    if (!err && out >= 0)
+    {
+        err = posix_spawn_file_actions_adddup2(&actions, out, STDOUT_FILENO);
+    }
+    if (!err)
+    {
+        stage->start = now();
+        err = posix_spawnp(&stage->pid, stage->argv[0], &actions, NULL, stage->argv, environ);
+    }
+    posix_spawn_file_actions_destroy(&actions);
+    if (err)
+    {
+        fprintf(stderr, "Error: %s failed. %s.\n", stage->argv[0], strerror(err));
+        stage->pid = 0;
+        return -1;
+    }
+    return 0;
+}
+
+static void report(const struct stage *stages, int n)
+{
+    for (int i = 0; i < n; i++)
+    {
+        const struct stage *s = &stages[i];
+        fprintf(stderr, "Stage %d (%s): ", i + 1, s->argv[0]);
+        if (s->pid == 0)
+        {
+            fprintf(stderr, "not started\n");
+            continue;
+        }
+        if (WIFSIGNALED(s->status))
+        {
+            fprintf(stderr, "killed by signal %d", WTERMSIG(s->status));
+        }
+        else
+        {
+            fprintf(stderr, "exit %d", WEXITSTATUS(s->status));
+        }
+        fprintf(stderr, ", wall %.3fs, user %.3fs, sys %.3fs, max RSS %ld KiB\n", s->end - s->start,
+                seconds(s->usage.ru_utime), seconds(s->usage.ru_stime), s->usage.ru_maxrss);
+    }
+}
+
+int pipeline_run(int argc, char **args)
+{
+    // Split the arguments into stages at each "|"
+    int n = 1;
+    for (int i = 0; i < argc; i++)
+    {
+        n += strcmp(args[i], "|") == 0;
+    }
+    struct stage *stages = calloc((size_t)n, sizeof(*stages));
+    if (!stages)
+    {
+        fprintf(stderr, "Error: calloc() failed. %s.\n", strerror(errno));
+        return -1;
+    }
+    stages[0].argv = args;
+    for (int i = 0, s = 0; i < argc; i++)
+    {
+        if (strcmp(args[i], "|") == 0)
+        {
+            args[i] = NULL;
+            stages[++s].argv = &args[i + 1];
+        }
+    }
+    for (int s = 0; s < n; s++)
+    {
+        if (stages[s].argv[0] == NULL)
+        {
+            fprintf(stderr, "Error: Empty stage %d in pipeline.\n", s + 1);
+            free(stages);
+            return -1;
+        }
+    }
+
+    // Start every stage before waiting for any, passing each the read end
+    // of the previous pipe; our copies are closed as soon as they are handed on
+    int in = -1, rc = 0, running = 0;
+    for (int s = 0; s < n; s++)
+    {
+        int fds[2] = {-1, -1};
+        if (s < n - 1)
+        {
+            if (pipe2(fds, O_CLOEXEC) < 0)
+            {
+                fprintf(stderr, "Error: pipe2() failed. %s.\n", strerror(errno));
+                rc = -1;
+                break;
+            }
+            // Fewer context switches per byte; over the
+            // fs/pipe-max-size limit this fails and the default is kept
+            fcntl(fds[1], F_SETPIPE_SZ, PIPELINE_PIPE_SIZE);
+        }
+        if (spawn_stage(&stages[s], in, fds[1]) == 0)
+        {
+            running++;
+        }
+        if (in >= 0)
+        {
+            close(in);
+        }
+        if (fds[1] >= 0)
+        {
+            close(fds[1]);
+        }
+        in = fds[0];
+    }
+    if (in >= 0)
+    {
+        close(in);
+    }
+
+    // Reap in whatever order the stages finish, so each end time is exact
+    while (running > 0)
+    {
+        int status;
+        struct rusage usage;
+        pid_t pid = wait4(-1, &status, 0, &usage);
+        if (pid < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            fprintf(stderr, "Error: wait4() failed. %s.\n", strerror(errno));
+            rc = -1;
+            break;
+        }
+        for (int s = 0; s < n; s++)
+        {
+            if (stages[s].pid == pid)
+            {
+                stages[s].status = status;
+                stages[s].usage = usage;
+                stages[s].end = now();
+                running--;
+            }
+        }
+    }
+
+    report(stages, n);
+    if (rc == 0)
+    {
+        const struct stage *last = &stages[n - 1];
+        rc = last->pid == 0 ? 127 : WIFEXITED(last->status) ? WEXITSTATUS(last->status) : 128 + WTERMSIG(last->status);
+    }
+    free(stages);
+    return rc;
+}
@@ -0,0 +1,16 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+// Runs args as a pipeline: stages are separated by "|" arguments, e.g.
+// {"./pfind", "-d", "/usr", "-p", "rw-r--r--", "|", "sort", NULL}.
+// Every stage is started with posix_spawnp() (no fork() of this process),
+// connected by pipes enlarged to PIPELINE_PIPE_SIZE; the first stage reads
+// our stdin and the last writes our stdout. Prints each stage's exit
+// status, wall time and CPU time to stderr once they have all finished.
+// Returns the last stage's exit status like a shell, or -1 if the
+// pipeline could not be set up (an error has been printed).
+int pipeline_run(int argc, char **args);
+
+#define PIPELINE_PIPE_SIZE (1024 * 1024)
+
+#endif
@@ -1,125 +1,189 @@
 #define _POSIX_C_SOURCE 200809L
-#include <stdio.h>     // For printf, fprintf
-#include <stdlib.h>    // For EXIT_SUCCESS, EXIT_FAILURE
-#include <unistd.h>    // For getopt and optarg
-#include <sys/types.h> // For fork
-#include <sys/wait.h>  // For waitpid
-#include <string.h>    // For strcmp
-#include <errno.h>     // For errno
+#define _DEFAULT_SOURCE // For MAP_ANONYMOUS
+#include <stdio.h>  // For printf, fprintf
+#include <stdlib.h> // For EXIT_SUCCESS, EXIT_FAILURE, qsort
+#include <unistd.h> // For STDOUT_FILENO
+#include <string.h> // For strcmp, strcoll
+#include <errno.h>  // For errno
+#include <locale.h> // For setlocale, so the order matches sort(1)
+#include <dirent.h>   // For opendir, closedir
+#include <sys/mman.h> // For mmap, so vmsplice()d pages are never reused by malloc
+#include "pfind.h"    // From part1: permission string helpers
+#include "libpfind.h" // From part1: the pfind traversal
+#include "xfer.h"
+#include "pipeline.h"
+
+// Every match, stored back to back as NUL-terminated strings.
+// Offsets (not pointers) are kept because data moves when it grows.
+struct arena
+{
+    char *data;
+    size_t used;
+    size_t cap;
+    size_t *offsets;
+    size_t count;
+    size_t offsets_cap;
+    int failed; // An allocation failed and the walk was stopped
+};
+
+static int use_strcoll; // Set when the locale collates differently from strcmp
+
+static int grow(void **buffer, size_t *cap, size_t need, size_t elem_size)
+{
+    if (need <= *cap)
+    {
+        return 0;
+    }
+    size_t new_cap = *cap ? *cap : 4096;
+    while (new_cap < need)
+    {
+        new_cap *= 2;
+    }
+    void *grown = realloc(*buffer, new_cap * elem_size);
+    if (!grown)
+    {
+        fprintf(stderr, "Error: realloc() failed. %s.\n", strerror(errno));
+        return -1;
+    }
+    *buffer = grown;
+    *cap = new_cap;
+    return 0;
+}
 
-#define BUFFER_SIZE 4096 // For buffer size, can be adjusted as needed
+// Walk callback: copy the path into the arena; stops the walk if it cannot grow
+static int collect_match(struct pfind_entry *entry, void *ctx)
+{
+    struct arena *arena = ctx;
+    const char *path = entry->path;
+    size_t len = entry->path_len;
+    if (grow((void **)&arena->data, &arena->cap, arena->used + len + 1, 1) < 0 ||
+        grow((void **)&arena->offsets, &arena->offsets_cap, arena->count + 1, sizeof(size_t)) < 0)
+    {
+        arena->failed = 1;
+        return 1;
+    }
+    arena->offsets[arena->count++] = arena->used;
+    memcpy(arena->data + arena->used, path, len + 1);
+    arena->used += len + 1;
+    return 0;
+}
+
+// Same order as sort(1): the locale's collation, ties broken bytewise
+static int compare_paths(const void *a, const void *b)
+{
+    const char *pa = *(const char *const *)a;
+    const char *pb = *(const char *const *)b;
+    if (use_strcoll)
+    {
+        int order = strcoll(pa, pb);
+        if (order != 0)
+        {
+            return order;
+        }
+    }
+    return strcmp(pa, pb);
+}
 
 int main(int argc, char *argv[])
 {
+    // ./spfind -- <command> [args...] ['|' <command> [args...]]...
+    if (argc > 2 && strcmp(argv[1], "--") == 0)
+    {
+        int rc = pipeline_run(argc - 2, argv + 2);
+        return rc < 0 ? EXIT_FAILURE : rc;
+    }
+
     // Check if the correct number of arguments is provided
     // and if the options are in the correct order
     // i.e., ./spfind -d <directory> -p <permissions string>
     if (argc != 5 || strcmp(argv[1], "-d") != 0 || strcmp(argv[3], "-p") != 0)
     {
-        fprintf(stderr, "Usage: ./spfind -d <directory> -p <permissions string>\n");
+        fprintf(stderr, "Usage: ./spfind -d <directory> -p <permissions string>\n"
+                        "       ./spfind -- <command> [args...] ['|' <command> [args...]]...\n");
         return EXIT_FAILURE;
     }
 
-    int pps[2]; // integer array of size 2 for the pipe between pfind and sort (pps: pipe pfind sort)
-    int psp[2]; // integer array of size 2 for the pipe between sort and parent (psp: pipe sort parent)
-
-    if (pipe(pps) == -1) // check if pipe creation failed
+    // Same checks (and messages) pfind makes before walking
+    if (!perm_is_valid(argv[4]))
     {
-        perror("pipe");
+        fprintf(stderr, "Error: Permissions string '%s' is invalid.\n", argv[4]);
         return EXIT_FAILURE;
     }
-
-    if (pipe(psp) == -1)
+    DIR *dir = opendir(argv[2]);
+    if (dir == NULL)
     {
-        perror("pipe");
+        fprintf(stderr, "Error: Cannot open directory '%s'.\n", argv[2]);
         return EXIT_FAILURE;
     }
-
-    pid_t pid_pfind = fork(); // Create a child process, check if fork failed
-    if (pid_pfind < 0)
+    closedir(dir);
+
+    setlocale(LC_ALL, ""); // sort(1) orders by the user's locale, so do we
+    const char *collate = setlocale(LC_COLLATE, NULL);
+    use_strcoll = collate && strcmp(collate, "C") != 0 && strcmp(collate, "POSIX") != 0;
+
+    // Walk in-process instead of running ./pfind, collecting matches in the arena
+    struct arena arena = {0};
+    struct pfind_options walk;
+    pfind_options_init(&walk);
+    walk.perm = argv[4];
+    if (pfind_walk(argv[2], &walk, collect_match, &arena) < 0 || arena.failed)
     {
-        perror("fork");
+        free(arena.data);
+        free(arena.offsets);
         return EXIT_FAILURE;
     }
-    else if (pid_pfind == 0) // if successful, fork returns 0 to the child process
-    {
-        // this child process will run pfind
-        close(pps[0]);               // Close unused read end
-        dup2(pps[1], STDOUT_FILENO); // Redirect stdout to the write end of the pipe
-        close(pps[1]);               // Close the write end of the pipe
 
-        close(psp[0]); // Close unused read end
-        close(psp[1]); // Close unused write end
-
-        execl("./pfind", "pfind", "-d", argv[2], "-p", argv[4], NULL); // Execute pfind
-        // Note: execl does not return on success, so everything below should not be reached
-        fprintf(stderr, "Error: pfind failed.\n"); // If execl fails, print error message
-        exit(EXIT_FAILURE);
-    }
-
-    pid_t pid_sort = fork();
-    if (pid_sort < 0)
+    // Sort pointers to the paths instead of piping everything through sort(1)
+    char **paths = malloc((arena.count ? arena.count : 1) * sizeof(char *));
+    size_t output_size = arena.used ? arena.used : 1;
+    char *output = mmap(NULL, output_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (!paths || output == MAP_FAILED)
     {
-        perror("fork");
+        fprintf(stderr, "Error: Cannot allocate output. %s.\n", strerror(errno));
+        free(paths);
+        if (output != MAP_FAILED)
+        {
+            munmap(output, output_size);
+        }
+        free(arena.data);
+        free(arena.offsets);
         return EXIT_FAILURE;
     }
-    else if (pid_sort == 0)
+    for (size_t i = 0; i < arena.count; ++i)
     {
-        // this child process will run sort
-        close(pps[1]);              // Close unused write end
-        dup2(pps[0], STDIN_FILENO); // Redirect stdin to the read end of the pipe
-        // This allows sort to read the output of pfind
-        close(pps[0]); // Close the read end of the pipe
-
-        close(psp[0]);               // Close unused read end
-        dup2(psp[1], STDOUT_FILENO); // Redirect stdout to the write end of the pipe
-        close(psp[1]);               // Close the write end of the pipe
-
-        execlp("sort", "sort", NULL); // Execute sort via execlp
-        // Again, execlp does not return on success, so everything below should not be reached
-        // unless execlp fails
-        fprintf(stderr, "Error: sort failed.\n");
-        exit(EXIT_FAILURE);
+        paths[i] = arena.data + arena.offsets[i];
     }
+    qsort(paths, arena.count, sizeof(char *), compare_paths);
 
-    // Parent process
-    close(pps[0]); // Close unused read end
-    close(pps[1]); // Close unused write end
-    close(psp[1]); // Close unused write end
+    // Lay the sorted lines out in one buffer (same size as the arena: each
+    // NUL becomes a newline) and hand it to stdout in one go
+    size_t length = 0;
+    for (size_t i = 0; i < arena.count; ++i)
+    {
+        size_t n = strlen(paths[i]);
+        memcpy(output + length, paths[i], n);
+        length += n;
+        output[length++] = '\n';
+    }
 
-    char buffer[BUFFER_SIZE]; // Set to prevent overload (Don't want to blow the server)
-    ssize_t bytes_read;       // Keep track of bytes read from the pipe, ssize_t is signed size_t
-    // Note to self: ssize_t is used for read() to handle negative return values
-    int line_count = 0; // Keep track of lines by counting newlines (\n)
+    // Count lines like the old pipeline did: a path containing a newline
+    // counts twice, exactly as it did when reading sort's output
+    size_t line_count = xfer_count_lines(output, length);
 
-    while ((bytes_read = read(psp[0], buffer, BUFFER_SIZE)) > 0)
+    int rc = EXIT_SUCCESS;
+    if (xfer_write(STDOUT_FILENO, output, length) < 0)
     {
-        for (ssize_t i = 0; i < bytes_read; ++i)
-        {
-            putchar(buffer[i]); // putchar() because we want to print the output of sort letter by letter
-            if (buffer[i] == '\n')
-            {
-                ++line_count;
-            }
-        }
+        perror("write");
+        rc = EXIT_FAILURE;
     }
-
-    if (bytes_read < 0) // Check if read() failed
+    else
     {
-        perror("read");
-        return EXIT_FAILURE; // If read() fails, exit with failure
+        printf("Total matches: %zu\n", line_count);
     }
 
-    close(psp[0]); // Close the read end of the pipe
-
-    // Wait for both children?
-    // NOTE: This is important to prevent zombie processes
-    // and to ensure that the parent process does not exit before the children
-    // are done executing
-    waitpid(pid_pfind, NULL, 0);
-    waitpid(pid_sort, NULL, 0);
-
-    printf("Total matches: %d\n", line_count);
-
-    return EXIT_SUCCESS;
+    free(paths);
+    munmap(output, output_size);
+    free(arena.data);
+    free(arena.offsets);
+    return rc;
 }
@@ -0,0 +1,82 @@
+#define _GNU_SOURCE   // For vmsplice
+#include <stdint.h>   // For uint64_t
+#include <string.h>   // For memcpy
+#include <errno.h>    // For errno
+#include <fcntl.h>    // For vmsplice
+#include <unistd.h>   // For write
+#include <sys/uio.h>  // For struct iovec
+#include <sys/stat.h> // For fstat
+#include "xfer.h"
+
+#define ONES 0x0101010101010101ULL
+#define LOW7 0x7f7f7f7f7f7f7f7fULL
+
+size_t xfer_count_lines(const char *buf, size_t length)
+{
+    size_t lines = 0, i = 0;
+    const uint64_t newlines = ONES * '\n';
+
+    for (; i + 8 <= length; i += 8)
+    {
+        uint64_t word;
+        memcpy(&word, buf + i, sizeof(word)); // Unaligned-safe, compiles to one load
+        uint64_t x = word ^ newlines;         // Newline bytes become zero
+        // High bit set exactly in the bytes of x that are zero
+        uint64_t zero = ~(((x & LOW7) + LOW7) | x | LOW7);
+        lines += (size_t)__builtin_popcountll(zero);
+    }
+    for (; i < length; i++)
+    {
+        lines += buf[i] == '\n';
+    }
+    return lines;
+}
+
+static int write_blocks(int fd, const char *buf, size_t length)
+{
+    while (length > 0)
+    {
+        ssize_t n = write(fd, buf, length);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return -1;
+        }
+        buf += n;
+        length -= (size_t)n;
+    }
+    return 0;
+}
+
+int xfer_write(int fd, const char *buf, size_t length)
+{
+    struct stat st;
+    if (fstat(fd, &st) < 0 || !S_ISFIFO(st.st_mode))
+    {
+        return write_blocks(fd, buf, length);
+    }
+
+    while (length > 0)
+    {
+        struct iovec iov = {.iov_base = (void *)buf, .iov_len = length};
+        ssize_t n = vmsplice(fd, &iov, 1, 0);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            if (errno == EINVAL || errno == ENOSYS) // Not spliceable after all
+            {
+                return write_blocks(fd, buf, length);
+            }
+            return -1;
+        }
+        buf += n;
+        length -= (size_t)n;
+    }
+    return 0;
+}
@@ -0,0 +1,14 @@
+#ifndef XFER_H
+#define XFER_H
+
+#include <stddef.h> // For size_t
+
+// Counts '\n' bytes in buf, eight bytes at a time
+size_t xfer_count_lines(const char *buf, size_t length);
+
+// Writes all of buf to fd. When fd is a pipe the pages are handed to the
+// pipe with vmsplice() instead of being copied, so buf must not be changed
+// afterwards (unmapping it is fine). Returns 0, or -1 with errno set.
+int xfer_write(int fd, const char *buf, size_t length);
+
+#endif
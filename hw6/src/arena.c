@@ -0,0 +1,107 @@
+#include "minishell.h"
+#include "arena.h"
+
+// Makes room for at least one more byte of the string being built, moving
+// what there is of it to the next chunk (reused, or new if it is too small)
+static int make_room(struct arena *arena)
+{
+    struct arena_chunk *current = arena->current;
+    if (current && current->used < current->cap)
+    {
+        return 0;
+    }
+
+    size_t partial = current ? current->used - arena->start : 0;
+    struct arena_chunk *next = current ? current->next : arena->first;
+    if (!next || next->cap < partial * 2)
+    {
+        size_t cap = partial * 2 > ARENA_CHUNK ? partial * 2 : ARENA_CHUNK;
+        struct arena_chunk *chunk = malloc(sizeof(*chunk) + cap);
+        if (!chunk)
+        {
+            fprintf(stderr, "Error: malloc() failed. %s.\n", strerror(errno));
+            return -1;
+        }
+        chunk->cap = cap;
+        chunk->next = next;
+        if (current)
+        {
+            current->next = chunk;
+        }
+        else
+        {
+            arena->first = chunk;
+        }
+        next = chunk;
+    }
+
+    next->used = partial;
+    if (partial)
+    {
+        memcpy(next->data, current->data + arena->start, partial);
+        current->used = arena->start; // The string no longer lives here
+    }
+    arena->current = next;
+    arena->start = 0;
+    return 0;
+}
+
+int arena_putc(struct arena *arena, char c)
+{
+    if (make_room(arena) == -1)
+    {
+        return -1;
+    }
+    arena->current->data[arena->current->used++] = c;
+    return 0;
+}
+
+int arena_puts(struct arena *arena, const char *s)
+{
+    for (; *s; s++)
+    {
+        if (arena_putc(arena, *s) == -1)
+        {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+char *arena_finish(struct arena *arena)
+{
+    if (arena_putc(arena, '\0') == -1)
+    {
+        return NULL;
+    }
+    char *s = arena->current->data + arena->start;
+    arena->start = arena->current->used;
+    return s;
+}
+
+size_t arena_length(const struct arena *arena)
+{
+    return arena->current ? arena->current->used - arena->start : 0;
+}
+
+void arena_reset(struct arena *arena)
+{
+    for (struct arena_chunk *chunk = arena->first; chunk; chunk = chunk->next)
+    {
+        chunk->used = 0;
+    }
+    arena->current = arena->first;
+    arena->start = 0;
+}
+
+void arena_free(struct arena *arena)
+{
+    while (arena->first)
+    {
+        struct arena_chunk *next = arena->first->next;
+        free(arena->first);
+        arena->first = next;
+    }
+    arena->current = NULL;
+    arena->start = 0;
+}
@@ -0,0 +1,43 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h> // For size_t
+
+#define ARENA_CHUNK 65536 // Bytes in a chunk, unless a string needs more
+
+struct arena_chunk
+{
+    struct arena_chunk *next;
+    size_t cap;
+    size_t used;
+    char data[];
+};
+
+// Strings of one input line. They are built a character at a time at the
+// end of the current chunk, and all of them go away with arena_reset(),
+// which keeps the chunks: once the arena has grown to fit the longest
+// line, lexing allocates nothing.
+struct arena
+{
+    struct arena_chunk *first;
+    struct arena_chunk *current;
+    size_t start; // Where the string being built begins in current
+};
+
+// Appends to the string being built. Returns 0, or -1 if out of memory
+// (an error has been printed).
+int arena_putc(struct arena *arena, char c);
+int arena_puts(struct arena *arena, const char *s);
+
+// Ends the string being built and returns it; the next one starts after it
+char *arena_finish(struct arena *arena);
+
+// Length of the string being built so far
+size_t arena_length(const struct arena *arena);
+
+// Forgets every string, keeping the memory for the next line
+void arena_reset(struct arena *arena);
+
+void arena_free(struct arena *arena);
+
+#endif
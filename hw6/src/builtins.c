@@ -0,0 +1,335 @@
+#define _POSIX_C_SOURCE 200809L
+#include "minishell.h"
+#include <sys/stat.h> // For stat, lstat
+#include "builtins.h"
+#include "pathcache.h"
+#include "jobs.h"
+#include "parallel.h"
+
+static int builtin_true(int argc, char **argv)
+{
+    (void)argc;
+    (void)argv;
+    return EXIT_SUCCESS;
+}
+
+static int builtin_false(int argc, char **argv)
+{
+    (void)argc;
+    (void)argv;
+    return EXIT_FAILURE;
+}
+
+// echo [-n] [arg...]
+static int builtin_echo(int argc, char **argv)
+{
+    int i = 1;
+    bool newline = true;
+    if (i < argc && strcmp(argv[i], "-n") == 0)
+    {
+        newline = false;
+        i++;
+    }
+    for (; i < argc; i++)
+    {
+        fputs(argv[i], stdout);
+        if (i < argc - 1)
+        {
+            putchar(' ');
+        }
+    }
+    if (newline)
+    {
+        putchar('\n');
+    }
+    return EXIT_SUCCESS;
+}
+
+static int builtin_pwd(int argc, char **argv)
+{
+    (void)argc;
+    (void)argv;
+    char cwd[PATH_MAX];
+    if (getcwd(cwd, sizeof(cwd)) == NULL)
+    {
+        fprintf(stderr, "Error: Cannot get current working directory. %s.\n", strerror(errno));
+        return EXIT_FAILURE;
+    }
+    puts(cwd);
+    return EXIT_SUCCESS;
+}
+
+// Prints the escape sequence at *s (just past the backslash), advancing *s
+static void print_escape(const char **s)
+{
+    char c = **s;
+    const char *from = "abfnrtv\\";
+    const char *to = "\a\b\f\n\r\t\v\\";
+    const char *hit = c ? strchr(from, c) : NULL;
+    if (hit)
+    {
+        putchar(to[hit - from]);
+        (*s)++;
+    }
+    else if (c >= '0' && c <= '7') // \NNN, up to three octal digits
+    {
+        int value = 0;
+        for (int n = 0; n < 3 && **s >= '0' && **s <= '7'; n++, (*s)++)
+        {
+            value = value * 8 + (**s - '0');
+        }
+        putchar(value);
+    }
+    else
+    {
+        putchar('\\'); // Not an escape; printed as it is
+    }
+}
+
+// Parses a numeric printf argument, complaining (but going on) if it is not one
+static long long number_arg(const char *arg, int *status)
+{
+    if (*arg == '\'' || *arg == '"') // 'c is the character code of c
+    {
+        return (unsigned char)arg[1];
+    }
+    char *end;
+    errno = 0;
+    long long value = strtoll(arg, &end, 0);
+    if (end == arg || *end || errno)
+    {
+        fprintf(stderr, "Error: printf: invalid number: %s\n", arg);
+        *status = EXIT_FAILURE;
+    }
+    return value;
+}
+
+// printf format [arg...]: %s %c %d %i %u %o %x %X %% with flags, width and
+// precision, and backslash escapes. The format is reused while arguments
+// remain, as in the printf utility.
+static int builtin_printf(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "Error: printf: missing format.\n");
+        return EXIT_FAILURE;
+    }
+    int status = EXIT_SUCCESS;
+    int next = 2;
+    do
+    {
+        int first = next;
+        for (const char *f = argv[1]; *f;)
+        {
+            if (*f == '\\')
+            {
+                f++;
+                print_escape(&f);
+                continue;
+            }
+            if (*f != '%')
+            {
+                putchar(*f++);
+                continue;
+            }
+            if (f[1] == '%')
+            {
+                putchar('%');
+                f += 2;
+                continue;
+            }
+
+            // Copy the conversion's flags, width and precision into spec,
+            // leaving room for the "ll" length modifier
+            char spec[32];
+            size_t len = strspn(f + 1, "-+ #0123456789.") + 1;
+            if (len > sizeof(spec) - 4 || !f[len] || !strchr("scdiuoxX", f[len]))
+            {
+                fprintf(stderr, "Error: printf: invalid conversion in '%s'.\n", argv[1]);
+                return EXIT_FAILURE;
+            }
+            memcpy(spec, f, len);
+            char conv = f[len];
+            f += len + 1;
+            const char *arg = next < argc ? argv[next++] : NULL;
+
+            if (conv == 's' || conv == 'c')
+            {
+                spec[len] = 's';
+                spec[len + 1] = '\0';
+                char one[2] = {arg ? arg[0] : '\0', '\0'};
+                printf(spec, conv == 'c' ? one : arg ? arg : "");
+            }
+            else
+            {
+                spec[len] = 'l';
+                spec[len + 1] = 'l';
+                spec[len + 2] = conv;
+                spec[len + 3] = '\0';
+                long long value = arg ? number_arg(arg, &status) : 0;
+                if (conv == 'd' || conv == 'i')
+                {
+                    printf(spec, value);
+                }
+                else
+                {
+                    printf(spec, (unsigned long long)value);
+                }
+            }
+        }
+        if (next == first)
+        {
+            break; // The format takes no arguments
+        }
+    } while (next < argc);
+    return status;
+}
+
+// Parses an integer operand of test; returns -1 if it is not one
+static int test_number(const char *arg, long long *value)
+{
+    char *end;
+    errno = 0;
+    *value = strtoll(arg, &end, 10);
+    if (end == arg || *end || errno)
+    {
+        fprintf(stderr, "Error: test: integer expected: %s\n", arg);
+        return -1;
+    }
+    return 0;
+}
+
+// Evaluates a test expression of one to three operands (after any '!').
+// Returns 0 for true, 1 for false and 2 for a bad expression.
+static int test_expression(int argc, char **argv)
+{
+    if (argc == 0)
+    {
+        return 1;
+    }
+    if (strcmp(argv[0], "!") == 0 && argc > 1)
+    {
+        int result = test_expression(argc - 1, argv + 1);
+        return result == 2 ? 2 : !result;
+    }
+    if (argc == 1)
+    {
+        return argv[0][0] == '\0';
+    }
+    if (argc == 2)
+    {
+        const char *op = argv[0], *arg = argv[1];
+        struct stat st;
+        if (strcmp(op, "-z") == 0)
+        {
+            return arg[0] != '\0';
+        }
+        if (strcmp(op, "-n") == 0)
+        {
+            return arg[0] == '\0';
+        }
+        if (strcmp(op, "-L") == 0 || strcmp(op, "-h") == 0)
+        {
+            return !(lstat(arg, &st) == 0 && S_ISLNK(st.st_mode));
+        }
+        if (strcmp(op, "-r") == 0 || strcmp(op, "-w") == 0 || strcmp(op, "-x") == 0)
+        {
+            int mode = op[1] == 'r' ? R_OK : op[1] == 'w' ? W_OK : X_OK;
+            return access(arg, mode) != 0;
+        }
+        if (strlen(op) == 2 && op[0] == '-' && strchr("edfs", op[1]))
+        {
+            if (stat(arg, &st) != 0)
+            {
+                return 1;
+            }
+            switch (op[1])
+            {
+            case 'd':
+                return !S_ISDIR(st.st_mode);
+            case 'f':
+                return !S_ISREG(st.st_mode);
+            case 's':
+                return st.st_size == 0;
+            default:
+                return 0;
+            }
+        }
+        fprintf(stderr, "Error: test: unknown operator: %s\n", op);
+        return 2;
+    }
+    if (argc == 3)
+    {
+        const char *op = argv[1];
+        if (strcmp(op, "=") == 0 || strcmp(op, "==") == 0)
+        {
+            return strcmp(argv[0], argv[2]) != 0;
+        }
+        if (strcmp(op, "!=") == 0)
+        {
+            return strcmp(argv[0], argv[2]) == 0;
+        }
+        static const char *const numeric[] = {"-eq", "-ne", "-lt", "-le", "-gt", "-ge"};
+        for (int n = 0; n < 6; n++)
+        {
+            if (strcmp(op, numeric[n]) == 0)
+            {
+                long long a, b;
+                if (test_number(argv[0], &a) == -1 || test_number(argv[2], &b) == -1)
+                {
+                    return 2;
+                }
+                bool results[] = {a == b, a != b, a < b, a <= b, a > b, a >= b};
+                return !results[n];
+            }
+        }
+        fprintf(stderr, "Error: test: unknown operator: %s\n", op);
+        return 2;
+    }
+    fprintf(stderr, "Error: test: too many arguments.\n");
+    return 2;
+}
+
+// test expr, or [ expr ]
+static int builtin_test(int argc, char **argv)
+{
+    if (strcmp(argv[0], "[") == 0)
+    {
+        if (strcmp(argv[argc - 1], "]") != 0)
+        {
+            fprintf(stderr, "Error: [: missing ']'.\n");
+            return 2;
+        }
+        argc--;
+    }
+    return test_expression(argc - 1, argv + 1);
+}
+
+// Sorted by name for bsearch()
+static const struct builtin builtins[] = {
+    {"[", builtin_test},
+    {"bg", builtin_bg},
+    {"cd", builtin_cd},
+    {"echo", builtin_echo},
+    {"exit", builtin_exit},
+    {"false", builtin_false},
+    {"fg", builtin_fg},
+    {"hash", builtin_hash},
+    {"jobs", builtin_jobs},
+    {"parallel", builtin_parallel},
+    {"printf", builtin_printf},
+    {"pwd", builtin_pwd},
+    {"test", builtin_test},
+    {"true", builtin_true},
+    {"wait", builtin_wait},
+};
+
+static int compare_builtin(const void *key, const void *entry)
+{
+    return strcmp(key, ((const struct builtin *)entry)->name);
+}
+
+const struct builtin *builtin_find(const char *name)
+{
+    return bsearch(name, builtins, sizeof(builtins) / sizeof(builtins[0]), sizeof(builtins[0]), compare_builtin);
+}
@@ -0,0 +1,15 @@
+#ifndef BUILTINS_H
+#define BUILTINS_H
+
+// A command run inside the shell instead of by fork+exec. It writes
+// through stdio and returns its exit status.
+struct builtin
+{
+    const char *name;
+    int (*run)(int argc, char **argv);
+};
+
+// Returns the builtin called name, or NULL
+const struct builtin *builtin_find(const char *name);
+
+#endif
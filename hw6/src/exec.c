@@ -0,0 +1,500 @@
+#define _GNU_SOURCE // For wait4, timersub and posix_spawn_file_actions_addtcsetpgrp_np
+#include "minishell.h"
+#include <fcntl.h>        // For open, fcntl
+#include <spawn.h>        // For posix_spawn
+#include <sys/resource.h> // For getrusage, wait4
+#include <sys/time.h>     // For timersub
+#include "exec.h"
+#include "builtins.h"
+#include "jobs.h"
+#include "pathcache.h"
+
+int last_status = 0;
+
+extern char **environ;
+
+// Opens a redirection target. Returns the descriptor (close-on-exec), or
+// -1 (an error has been printed).
+static int open_redirect(const char *file, int flags)
+{
+    int fd = open(file, flags | O_CLOEXEC, 0666);
+    if (fd == -1)
+    {
+        fprintf(stderr, "Error: Cannot open '%s'. %s.\n", file, strerror(errno));
+    }
+    return fd;
+}
+
+// Runs a file the kernel would not execute (no #! line) as a /bin/sh
+// script, as execvp() does: /bin/sh path args... Returns 0 or an errno value.
+static int spawn_script(pid_t *pid, const char *path, const struct command *cmd,
+                        const posix_spawn_file_actions_t *actions, const posix_spawnattr_t *attr)
+{
+    size_t argc = 0;
+    while (cmd->argv[argc])
+    {
+        argc++;
+    }
+    char **argv = malloc((argc + 2) * sizeof(*argv));
+    if (!argv)
+    {
+        return errno;
+    }
+    argv[0] = "/bin/sh";
+    argv[1] = (char *)path;
+    memcpy(argv + 2, cmd->argv + 1, argc * sizeof(*argv)); // Arguments and the NULL
+    int err = posix_spawn(pid, "/bin/sh", actions, attr, argv, environ);
+    free(argv);
+    return err;
+}
+
+// Runs the command at its cached path with posix_spawn(), so no PATH
+// search happens per run. A cached path that is gone or no longer
+// executable (ENOENT, EACCES) is dropped and looked up once more; any
+// other error is the command's own. Returns 0 or an errno value.
+static int spawn_resolved(pid_t *pid, const struct command *cmd, const posix_spawn_file_actions_t *actions,
+                          const posix_spawnattr_t *attr)
+{
+    int err = ENOENT; // Until a path is found
+    for (int attempt = 0; attempt < 2; attempt++)
+    {
+        const char *path = path_lookup(cmd->argv[0]);
+        if (!path)
+        {
+            return err; // Not in PATH (any more): the cached path's error stands
+        }
+        err = posix_spawn(pid, path, actions, attr, cmd->argv, environ);
+        if (err == ENOEXEC)
+        {
+            return spawn_script(pid, path, cmd, actions, attr);
+        }
+        if (!err || path == cmd->argv[0] || (err != ENOENT && err != EACCES))
+        {
+            return err;
+        }
+        path_forget(cmd->argv[0]);
+    }
+    return err;
+}
+
+// Signals the shell ignores under job control that its children must not
+static const int job_signals[] = {SIGTSTP, SIGTTIN, SIGTTOU};
+
+// Runs a builtin that is one stage of a pipeline (or in the background).
+// It has to run next to the other stages, so it gets a plain fork() of the
+// shell (still no exec) with in and out as its stdin and stdout, in process
+// group pgid (a new one if 0) under job control, which takes the terminal
+// if foreground. Returns the pid or -1.
+static pid_t fork_builtin(const struct builtin *builtin, const struct command *cmd, int in, int out, int pipes[][2],
+                          int npipes, pid_t pgid, bool foreground)
+{
+    fflush(stdout); // Or the child would print our buffered output again
+    pid_t pid = fork();
+    if (pid == -1)
+    {
+        fprintf(stderr, "Error: fork() failed. %s.\n", strerror(errno));
+        return -1;
+    }
+    if (pid > 0)
+    {
+        if (job_control)
+        {
+            setpgid(pid, pgid); // Also here, so it holds before we wait or hand over the terminal
+        }
+        return pid;
+    }
+
+    if (job_control)
+    {
+        setpgid(0, pgid);
+        if (foreground)
+        {
+            tcsetpgrp(STDIN_FILENO, getpgrp()); // SIGTTOU is still ignored here
+        }
+        for (size_t s = 0; s < sizeof(job_signals) / sizeof(job_signals[0]); s++)
+        {
+            signal(job_signals[s], SIG_DFL);
+        }
+    }
+    if ((in != -1 && dup2(in, STDIN_FILENO) == -1) || (out != -1 && dup2(out, STDOUT_FILENO) == -1))
+    {
+        fprintf(stderr, "Error: dup2() failed. %s.\n", strerror(errno));
+        _exit(EXIT_FAILURE);
+    }
+    // Close-on-exec does not help without an exec; a stray write end
+    // would keep the next stage from ever seeing end-of-file
+    for (int p = 0; p < npipes; p++)
+    {
+        close(pipes[p][0]);
+        close(pipes[p][1]);
+    }
+    if (in > STDOUT_FILENO)
+    {
+        close(in);
+    }
+    if (out > STDOUT_FILENO)
+    {
+        close(out);
+    }
+    int status = builtin->run(cmd->argc, cmd->argv);
+    if (fflush(stdout) == EOF && status == EXIT_SUCCESS)
+    {
+        status = EXIT_FAILURE;
+    }
+    _exit(status);
+}
+
+// Starts stage i with posix_spawn(): the child is created without copying
+// the shell's page tables, and its stdin/stdout are set up by file actions
+// instead of code running in a forked copy. Explicit redirections win over
+// the pipe, as in bash; they are opened here so a bad file name gets its
+// own message. Builtins go to fork_builtin(). Under job control the
+// command joins process group *pgid, or starts it if that is 0, and a
+// foreground command gives that group the terminal before it runs, so
+// reading the terminal cannot stop it with SIGTTIN. Returns the pid, or -1
+// (an error has been printed).
+static pid_t spawn_stage(const struct pipeline *pl, int i, int pipes[][2], pid_t *pgid, bool foreground)
+{
+    const struct command *cmd = &pl->stages[i];
+    int in = i > 0 ? pipes[i - 1][0] : -1;
+    int out = i < pl->count - 1 ? pipes[i][1] : -1;
+    int in_file = -1, out_file = -1;
+    pid_t pid = -1;
+
+    if (cmd->input && (in = in_file = open_redirect(cmd->input, O_RDONLY)) == -1)
+    {
+        return -1;
+    }
+    if (cmd->output &&
+        (out = out_file = open_redirect(cmd->output, O_WRONLY | O_CREAT | (cmd->append ? O_APPEND : O_TRUNC))) == -1)
+    {
+        if (in_file != -1)
+        {
+            close(in_file);
+        }
+        return -1;
+    }
+
+    const struct builtin *builtin = builtin_find(cmd->argv[0]);
+    if (builtin)
+    {
+        pid = fork_builtin(builtin, cmd, in, out, pipes, pl->count - 1, *pgid, foreground);
+        if (pid != -1 && *pgid == 0 && job_control)
+        {
+            *pgid = pid;
+        }
+        if (in_file != -1)
+        {
+            close(in_file);
+        }
+        if (out_file != -1)
+        {
+            close(out_file);
+        }
+        return pid;
+    }
+
+    // Every pipe end and file is close-on-exec, so the child keeps only
+    // the two it gets as stdin and stdout
+    posix_spawn_file_actions_t actions;
+    int err = posix_spawn_file_actions_init(&actions);
+    if (!err && job_control && foreground)
+    {
+        // Runs in the child after it joined its group (with every signal
+        // blocked, so no SIGTTOU), and before stdin is replaced
+        err = posix_spawn_file_actions_addtcsetpgrp_np(&actions, STDIN_FILENO);
+    }
+    if (!err && in != -1)
+    {
+        err = posix_spawn_file_actions_adddup2(&actions, in, STDIN_FILENO);
+    }
+    if (!err && out != -1)
+    {
+        err = posix_spawn_file_actions_adddup2(&actions, out, STDOUT_FILENO);
+    }
+    posix_spawnattr_t attr;
+    bool use_attr = false;
+    if (!err && job_control)
+    {
+        sigset_t defaults;
+        sigemptyset(&defaults);
+        for (size_t s = 0; s < sizeof(job_signals) / sizeof(job_signals[0]); s++)
+        {
+            sigaddset(&defaults, job_signals[s]);
+        }
+        use_attr = !(err = posix_spawnattr_init(&attr));
+        if (!err)
+        {
+            posix_spawnattr_setpgroup(&attr, *pgid);
+            posix_spawnattr_setsigdefault(&attr, &defaults);
+            err = posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETPGROUP | POSIX_SPAWN_SETSIGDEF);
+        }
+    }
+    if (!err)
+    {
+        fflush(stdout); // Keep our buffered output ahead of the child's
+        err = spawn_resolved(&pid, cmd, &actions, use_attr ? &attr : NULL);
+    }
+    if (use_attr)
+    {
+        posix_spawnattr_destroy(&attr);
+    }
+    posix_spawn_file_actions_destroy(&actions);
+    if (!err && job_control)
+    {
+        // The child did this itself before exec; doing it here as well means
+        // it holds before we wait or hand the group the terminal
+        setpgid(pid, *pgid ? *pgid : pid);
+        if (*pgid == 0)
+        {
+            *pgid = pid;
+        }
+    }
+    if (err == ENOENT && !strchr(cmd->argv[0], '/'))
+    {
+        fprintf(stderr, "Error: Command not found: %s\n", cmd->argv[0]);
+        pid = -1;
+    }
+    else if (err)
+    {
+        fprintf(stderr, "Error: exec() failed. %s.\n", strerror(err));
+        pid = -1;
+    }
+
+    if (in_file != -1)
+    {
+        close(in_file);
+    }
+    if (out_file != -1)
+    {
+        close(out_file);
+    }
+    return pid;
+}
+
+pid_t spawn_command(char **argv, int out, bool null_stdin)
+{
+    struct command cmd = {.argv = argv};
+    posix_spawn_file_actions_t actions;
+    pid_t pid = -1;
+    int err = posix_spawn_file_actions_init(&actions);
+    if (!err && null_stdin)
+    {
+        err = posix_spawn_file_actions_addopen(&actions, STDIN_FILENO, "/dev/null", O_RDONLY, 0);
+    }
+    if (!err && out != -1)
+    {
+        err = posix_spawn_file_actions_adddup2(&actions, out, STDOUT_FILENO);
+    }
+    if (!err)
+    {
+        fflush(stdout); // Keep our buffered output ahead of the child's
+        err = spawn_resolved(&pid, &cmd, &actions, NULL);
+    }
+    posix_spawn_file_actions_destroy(&actions);
+    if (err == ENOENT && !strchr(argv[0], '/'))
+    {
+        fprintf(stderr, "Error: Command not found: %s\n", argv[0]);
+        return -1;
+    }
+    if (err)
+    {
+        fprintf(stderr, "Error: exec() failed. %s.\n", strerror(err));
+        return -1;
+    }
+    return pid;
+}
+
+// Points fd at file for the length of a builtin, keeping a copy of the
+// shell's own descriptor in *saved. Returns 0, or -1 (an error has been
+// printed).
+static int redirect_shell(int fd, const char *file, int flags, int *saved)
+{
+    int file_fd = open_redirect(file, flags);
+    if (file_fd == -1)
+    {
+        return -1;
+    }
+    fflush(stdout);
+    if ((*saved = fcntl(fd, F_DUPFD_CLOEXEC, 10)) == -1 || dup2(file_fd, fd) == -1)
+    {
+        fprintf(stderr, "Error: Cannot redirect. %s.\n", strerror(errno));
+        if (*saved != -1)
+        {
+            close(*saved);
+            *saved = -1;
+        }
+        close(file_fd);
+        return -1;
+    }
+    close(file_fd);
+    return 0;
+}
+
+static void restore_shell(int fd, int saved)
+{
+    if (saved != -1)
+    {
+        dup2(saved, fd);
+        close(saved);
+    }
+}
+
+// Runs a builtin on its own inside the shell, which is what lets cd and
+// exit work and saves echo and friends a process. Redirections are
+// applied to the shell's own stdin/stdout and undone afterwards.
+static void run_builtin(const struct builtin *builtin, const struct command *cmd)
+{
+    int saved_in = -1, saved_out = -1;
+    if (cmd->input && redirect_shell(STDIN_FILENO, cmd->input, O_RDONLY, &saved_in) == -1)
+    {
+        last_status = EXIT_FAILURE;
+        return;
+    }
+    if (cmd->output && redirect_shell(STDOUT_FILENO, cmd->output,
+                                      O_WRONLY | O_CREAT | (cmd->append ? O_APPEND : O_TRUNC), &saved_out) == -1)
+    {
+        restore_shell(STDIN_FILENO, saved_in);
+        last_status = EXIT_FAILURE;
+        return;
+    }
+
+    last_status = builtin->run(cmd->argc, cmd->argv);
+    if (saved_out != -1 && fflush(stdout) == EOF)
+    {
+        fprintf(stderr, "Error: Cannot write to '%s'. %s.\n", cmd->output, strerror(errno));
+        clearerr(stdout);
+        last_status = EXIT_FAILURE;
+    }
+    restore_shell(STDIN_FILENO, saved_in);
+    restore_shell(STDOUT_FILENO, saved_out);
+}
+
+// Turns *usage (from getrusage() now) into what was used since before;
+// max RSS stays the peak so far
+static void usage_since(struct rusage *usage, const struct rusage *before)
+{
+    getrusage(RUSAGE_SELF, usage);
+    timersub(&usage->ru_utime, &before->ru_utime, &usage->ru_utime);
+    timersub(&usage->ru_stime, &before->ru_stime, &usage->ru_stime);
+    usage->ru_nvcsw -= before->ru_nvcsw;
+    usage->ru_nivcsw -= before->ru_nivcsw;
+    usage->ru_majflt -= before->ru_majflt;
+    usage->ru_minflt -= before->ru_minflt;
+}
+
+void execute_pipeline(const struct pipeline *pl, bool background, struct timing *timing)
+{
+    int pipes[MAX_PIPE][2];
+    pid_t pids[MAX_PIPE];
+
+    const struct builtin *builtin;
+    if (pl->count == 1 && !background && (builtin = builtin_find(pl->stages[0].argv[0])) != NULL)
+    {
+        // No child to wait for: the builtin's usage is the shell's own
+        struct rusage before;
+        if (timing)
+        {
+            getrusage(RUSAGE_SELF, &before);
+        }
+        run_builtin(builtin, &pl->stages[0]);
+        if (timing)
+        {
+            usage_since(&timing->usage[0], &before);
+            timing->measured[0] = true;
+        }
+        return;
+    }
+
+    // Every pipe exists before the first command starts, so all of them
+    // can run at once and stream into each other
+    for (int p = 0; p < pl->count - 1; p++)
+    {
+        if (pipe(pipes[p]) == -1)
+        {
+            fprintf(stderr, "Error: pipe() failed. %s.\n", strerror(errno));
+            for (int q = 0; q < p; q++)
+            {
+                close(pipes[q][0]);
+                close(pipes[q][1]);
+            }
+            last_status = EXIT_FAILURE;
+            return;
+        }
+        // Cannot fail on a descriptor we just got
+        fcntl(pipes[p][0], F_SETFD, FD_CLOEXEC);
+        fcntl(pipes[p][1], F_SETFD, FD_CLOEXEC);
+    }
+
+    // A command that cannot start is skipped; the others still run, and
+    // see end-of-file (or a closed pipe) where it would have been
+    pid_t pgid = 0;
+    for (int i = 0; i < pl->count; i++)
+    {
+        double start = timing ? timing_now() : 0;
+        pids[i] = spawn_stage(pl, i, pipes, &pgid, !background);
+        if (timing)
+        {
+            timing->spawn[i] = timing_now() - start;
+        }
+        if (pgid != 0 && pids[i] == pgid && !background)
+        {
+            // The group's first command took the terminal itself; make sure
+            // it holds before the next one starts, as with setpgid()
+            job_terminal(pgid);
+        }
+    }
+
+    for (int p = 0; p < pl->count - 1; p++)
+    {
+        close(pipes[p][0]);
+        close(pipes[p][1]);
+    }
+
+    struct job *job = job_add(pl, pids, pgid, background);
+    if (job && background)
+    {
+        last_status = EXIT_SUCCESS;
+        return;
+    }
+    if (job)
+    {
+        job->timing = timing;
+        job_foreground(job, false);
+        return;
+    }
+
+    // No room in the job table: wait for the whole pipeline here; its
+    // status is the last command's
+    for (int i = 0; i < pl->count; i++)
+    {
+        if (pids[i] == -1)
+        {
+            last_status = 127; // As a shell reports a command that could not run
+            continue;
+        }
+        int status;
+        struct rusage usage;
+        bool failed = false; // No status or usage to record
+        while (wait4(pids[i], &status, 0, &usage) == -1)
+        {
+            if (errno != EINTR)
+            {
+                fprintf(stderr, "Error: wait4() failed. %s.\n", strerror(errno));
+                status = EXIT_FAILURE << 8;
+                failed = true;
+                break;
+            }
+        }
+        if (timing && !failed)
+        {
+            timing->usage[i] = usage;
+            timing->measured[i] = true;
+        }
+        if (i == pl->count - 1)
+        {
+            last_status = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+        }
+    }
+    job_terminal(0); // The pipeline may have had it
+}
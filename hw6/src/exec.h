@@ -0,0 +1,26 @@
+#ifndef EXEC_H
+#define EXEC_H
+
+#include <stdbool.h>   // For bool
+#include <sys/types.h> // For pid_t
+#include "parse.h"
+#include "timing.h"
+
+// Exit status of the last command run (the last stage of a pipeline)
+extern int last_status;
+
+// Runs every command of pl at the same time, each connected to the next by
+// a pipe, with its redirections applied, and waits for all of them.
+// Sets last_status from the last command. A builtin on its own runs inside
+// the shell; in a longer pipeline it runs in a forked child. With
+// background the pipeline goes into the job table and is not waited for.
+// If timing is not NULL (and not background), it is filled in for 'time'.
+void execute_pipeline(const struct pipeline *pl, bool background, struct timing *timing);
+
+// Starts the program argv[0] (found through the PATH cache, never a
+// builtin) with its stdout on out unless that is -1, and its stdin from
+// /dev/null if null_stdin. Returns the pid, or -1 (an error has been
+// printed).
+pid_t spawn_command(char **argv, int out, bool null_stdin);
+
+#endif
@@ -0,0 +1,412 @@
+#define _GNU_SOURCE // For getdents64
+#include "minishell.h"
+#include <dirent.h>   // For struct dirent64, getdents64
+#include <fcntl.h>    // For openat, O_DIRECTORY
+#include <fnmatch.h>  // For fnmatch
+#include <time.h>     // For clock_gettime
+#include <sys/stat.h> // For fstat, fstatat
+#include "glob.h"
+
+#define GLOB_CACHE 16            // Directory listings kept
+#define GLOB_READ_BUFFER 65536   // Bytes per getdents64() call
+
+// One name of a directory listing
+struct listed
+{
+    size_t offset; // Of the name in the listing's names
+    unsigned char type;
+};
+
+// A directory's names as getdents64() returned them. A listing is reused
+// while the directory's (dev, ino, mtime) stays the same, so globbing the
+// same large directory again does not read it again.
+struct listing
+{
+    dev_t dev;
+    ino_t ino;
+    struct timespec mtime;
+    char *names; // NUL-terminated, one after the other
+    size_t names_len, names_cap;
+    struct listed *entries;
+    size_t count, cap;
+    unsigned long last_used;
+    int pinned;  // Being iterated over; not to be evicted
+    bool valid;  // May be looked up again
+    bool cached; // Lives in cache[], rather than on the heap
+};
+
+static struct listing cache[GLOB_CACHE];
+static unsigned long clock_tick; // For least recently used eviction
+
+// State of one expansion
+struct globber
+{
+    struct arena *arena;
+    glob_fn fn;
+    void *ctx;
+    int matches;
+    char path[PATH_MAX]; // The directory being looked at, ending in '/' (or empty)
+};
+
+int glob_has_magic(const char *word)
+{
+    for (const char *p = word; *p; p++)
+    {
+        if (*p == '\\' && p[1])
+        {
+            p++;
+        }
+        else if (*p == '*' || *p == '?' || *p == '[')
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+void glob_unescape(char *word)
+{
+    char *out = word;
+    for (const char *p = word; *p; p++)
+    {
+        if (*p == '\\' && p[1])
+        {
+            p++;
+        }
+        *out++ = *p;
+    }
+    *out = '\0';
+}
+
+// Appends one name to a listing, growing it (only past its largest size)
+static int add_name(struct listing *list, const char *name, unsigned char type)
+{
+    size_t len = strlen(name) + 1;
+    if (list->names_len + len > list->names_cap)
+    {
+        size_t cap = list->names_cap ? list->names_cap * 2 : GLOB_READ_BUFFER;
+        while (cap < list->names_len + len)
+        {
+            cap *= 2;
+        }
+        char *names = realloc(list->names, cap);
+        if (!names)
+        {
+            fprintf(stderr, "Error: realloc() failed. %s.\n", strerror(errno));
+            return -1;
+        }
+        list->names = names;
+        list->names_cap = cap;
+    }
+    if (list->count == list->cap)
+    {
+        size_t cap = list->cap ? list->cap * 2 : 256;
+        struct listed *entries = realloc(list->entries, cap * sizeof(*entries));
+        if (!entries)
+        {
+            fprintf(stderr, "Error: realloc() failed. %s.\n", strerror(errno));
+            return -1;
+        }
+        list->entries = entries;
+        list->cap = cap;
+    }
+    memcpy(list->names + list->names_len, name, len);
+    list->entries[list->count].offset = list->names_len;
+    list->entries[list->count].type = type;
+    list->count++;
+    list->names_len += len;
+    return 0;
+}
+
+// Returns the listing of the open directory fd, pinned until
+// release_listing(): from the cache if the directory has not changed,
+// else read with getdents64(). NULL on failure (an error has been printed).
+static struct listing *list_directory(int fd)
+{
+    struct stat st;
+    if (fstat(fd, &st) == -1)
+    {
+        fprintf(stderr, "Error: stat() failed. %s.\n", strerror(errno));
+        return NULL;
+    }
+    clock_tick++;
+
+    struct listing *list = NULL;
+    for (int i = 0; i < GLOB_CACHE; i++)
+    {
+        struct listing *slot = &cache[i];
+        if (slot->valid && slot->dev == st.st_dev && slot->ino == st.st_ino &&
+            slot->mtime.tv_sec == st.st_mtim.tv_sec && slot->mtime.tv_nsec == st.st_mtim.tv_nsec)
+        {
+            slot->last_used = clock_tick;
+            slot->pinned++;
+            return slot;
+        }
+        // The least recently used slot not in use, keeping its buffers
+        if (!slot->pinned && (!list || slot->last_used < list->last_used))
+        {
+            list = slot;
+        }
+    }
+    if (list)
+    {
+        list->cached = true;
+    }
+    else if ((list = calloc(1, sizeof(*list))) == NULL) // Every slot is in use higher up a ** walk
+    {
+        fprintf(stderr, "Error: calloc() failed. %s.\n", strerror(errno));
+        return NULL;
+    }
+    list->valid = false;
+    list->count = 0;
+    list->names_len = 0;
+    list->pinned = 1;
+
+    char buffer[GLOB_READ_BUFFER];
+    ssize_t n;
+    lseek(fd, 0, SEEK_SET); // fd may have been read to the end already
+    while ((n = getdents64(fd, buffer, sizeof(buffer))) > 0)
+    {
+        for (ssize_t off = 0; off < n;)
+        {
+            struct dirent64 *entry = (struct dirent64 *)(buffer + off);
+            off += entry->d_reclen;
+            const char *name = entry->d_name;
+            if (strcmp(name, ".") == 0 || strcmp(name, "..") == 0)
+            {
+                continue;
+            }
+            if (add_name(list, name, entry->d_type) == -1)
+            {
+                n = 0;
+                break;
+            }
+        }
+    }
+    if (n == -1)
+    {
+        fprintf(stderr, "Error: getdents64() failed. %s.\n", strerror(errno));
+    }
+
+    // A directory changed in the same clock tick as this read could change
+    // again without its mtime moving, so only older ones are trusted later
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    list->dev = st.st_dev;
+    list->ino = st.st_ino;
+    list->mtime = st.st_mtim;
+    list->last_used = clock_tick;
+    list->valid = list->cached && n == 0 && st.st_mtim.tv_sec < now.tv_sec - 1;
+    return list;
+}
+
+static void release_listing(struct listing *list)
+{
+    if (list->cached)
+    {
+        list->pinned--;
+        return;
+    }
+    free(list->names);
+    free(list->entries);
+    free(list);
+}
+
+// Hands path (the directory plus name) to the callback as a new string
+static int report(struct globber *g, size_t dir_len, const char *name, bool slash)
+{
+    for (size_t i = 0; i < dir_len; i++)
+    {
+        if (arena_putc(g->arena, g->path[i]) == -1)
+        {
+            return -1;
+        }
+    }
+    if (arena_puts(g->arena, name) == -1 || (slash && arena_putc(g->arena, '/') == -1))
+    {
+        return -1;
+    }
+    char *path = arena_finish(g->arena);
+    if (!path || g->fn(g->ctx, path) == -1)
+    {
+        return -1;
+    }
+    g->matches++;
+    return 0;
+}
+
+// Whether name in dirfd is a directory; with follow, a link to one counts
+static bool is_directory(int dirfd, const char *name, unsigned char type, bool follow)
+{
+    if (type != DT_UNKNOWN && (type != DT_LNK || !follow))
+    {
+        return type == DT_DIR;
+    }
+    struct stat st;
+    return fstatat(dirfd, name, &st, follow ? 0 : AT_SYMLINK_NOFOLLOW) == 0 && S_ISDIR(st.st_mode);
+}
+
+// Appends name and '/' to g->path. Returns the new length, or -1 if the
+// path would be too long.
+static ssize_t push_path(struct globber *g, size_t len, const char *name)
+{
+    size_t name_len = strlen(name);
+    if (len + name_len + 2 > sizeof(g->path))
+    {
+        return -1;
+    }
+    memcpy(g->path + len, name, name_len);
+    g->path[len + name_len] = '/';
+    g->path[len + name_len + 1] = '\0';
+    return (ssize_t)(len + name_len + 1);
+}
+
+static int expand(struct globber *g, int dirfd, size_t len, char *rest);
+
+// Opens the subdirectory name of dirfd and expands rest in it
+static int descend(struct globber *g, int dirfd, size_t len, const char *name, char *rest)
+{
+    ssize_t sub_len = push_path(g, len, name);
+    if (sub_len == -1)
+    {
+        return 0;
+    }
+    int fd = openat(dirfd, name, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd == -1)
+    {
+        g->path[len] = '\0';
+        return 0; // Unreadable or not a directory: nothing matches below it
+    }
+    int result = expand(g, fd, (size_t)sub_len, rest);
+    close(fd);
+    g->path[len] = '\0';
+    return result;
+}
+
+// Matches the components in rest ("a/b*c/d") against the directory dirfd,
+// whose path is g->path[0..len). rest is cut at its first '/' while this
+// runs, and restored.
+static int expand(struct globber *g, int dirfd, size_t len, char *rest)
+{
+    while (*rest == '/')
+    {
+        rest++; // a//b is a/b
+    }
+    char *slash = strchr(rest, '/');
+    char *next = slash ? slash + 1 : NULL;
+    bool last = !next || !*next;
+    bool dirs_only = slash && last; // A trailing slash only matches directories
+    int result = 0;
+
+    if (strcmp(rest, "**") == 0 || strncmp(rest, "**/", 3) == 0)
+    {
+        // ** matches no directory at all, and any number of them: what
+        // follows it is matched here, and ** again in every subdirectory
+        // (not through links, which could loop). On its own at the end it
+        // matches everything below.
+        char star[] = "*";
+        result = expand(g, dirfd, len, last ? star : next);
+        struct listing *list = result == -1 ? NULL : list_directory(dirfd);
+        for (size_t i = 0; list && i < list->count && result != -1; i++)
+        {
+            const char *name = list->names + list->entries[i].offset;
+            if (name[0] != '.' && is_directory(dirfd, name, list->entries[i].type, false))
+            {
+                result = descend(g, dirfd, len, name, rest);
+            }
+        }
+        if (list)
+        {
+            release_listing(list);
+        }
+        return result;
+    }
+
+    if (slash)
+    {
+        *slash = '\0';
+    }
+    if (!glob_has_magic(rest))
+    {
+        // A plain component: no need to read the directory
+        char name[NAME_MAX + 1];
+        snprintf(name, sizeof(name), "%s", rest);
+        glob_unescape(name);
+        struct stat st;
+        if (!last)
+        {
+            result = descend(g, dirfd, len, name, next);
+        }
+        else if (fstatat(dirfd, name, &st, AT_SYMLINK_NOFOLLOW) == 0 &&
+                 (!dirs_only || is_directory(dirfd, name, DT_UNKNOWN, true)))
+        {
+            result = report(g, len, name, dirs_only);
+        }
+    }
+    else
+    {
+        struct listing *list = list_directory(dirfd);
+        result = list ? 0 : -1;
+        bool dot = rest[0] == '.' || (rest[0] == '\\' && rest[1] == '.');
+        for (size_t i = 0; list && i < list->count && result != -1; i++)
+        {
+            const char *name = list->names + list->entries[i].offset;
+            unsigned char type = list->entries[i].type;
+            if ((name[0] == '.' && !dot) || fnmatch(rest, name, 0) != 0)
+            {
+                continue;
+            }
+            if (last && (!dirs_only || is_directory(dirfd, name, type, true)))
+            {
+                result = report(g, len, name, dirs_only);
+            }
+            else if (!last && is_directory(dirfd, name, type, true))
+            {
+                result = descend(g, dirfd, len, name, next);
+            }
+        }
+        if (list)
+        {
+            release_listing(list);
+        }
+    }
+
+    if (slash)
+    {
+        *slash = '/';
+    }
+    return result;
+}
+
+int glob_expand(const char *pattern, struct arena *arena, glob_fn fn, void *ctx)
+{
+    static struct globber g; // The path buffer is large, and not needed on the stack
+    g.arena = arena;
+    g.fn = fn;
+    g.ctx = ctx;
+    g.matches = 0;
+    g.path[0] = '\0';
+
+    char copy[PATH_MAX];
+    if (snprintf(copy, sizeof(copy), "%s", pattern) >= (int)sizeof(copy))
+    {
+        return 0; // Longer than any path; it cannot match
+    }
+    size_t len = 0;
+    const char *start = ".";
+    if (copy[0] == '/')
+    {
+        g.path[0] = '/';
+        g.path[1] = '\0';
+        len = 1;
+        start = "/";
+    }
+    int fd = open(start, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd == -1)
+    {
+        return 0;
+    }
+    int result = expand(&g, fd, len, copy + len);
+    close(fd);
+    return result == -1 ? -1 : g.matches;
+}
@@ -0,0 +1,23 @@
+#ifndef GLOB_H
+#define GLOB_H
+
+#include "arena.h"
+
+// Called with each path a pattern matches; returns -1 to stop
+typedef int (*glob_fn)(void *ctx, char *path);
+
+// Expands pattern: * and ? match within a name, [...] (or [!...]) matches
+// one character of a set, a ** component matches any number of
+// directories, and a backslash makes the next character literal. Names
+// starting with '.' only match a component that starts with '.' too. The
+// paths are built in arena and handed to fn unsorted. Returns the number
+// of matches, or -1 (an error has been printed).
+int glob_expand(const char *pattern, struct arena *arena, glob_fn fn, void *ctx);
+
+// True if word has a *, ? or [ not escaped by a backslash
+int glob_has_magic(const char *word);
+
+// Removes the escaping backslashes from word, in place
+void glob_unescape(char *word);
+
+#endif
@@ -0,0 +1,120 @@
+#define _POSIX_C_SOURCE 200809L
+#include "minishell.h"
+#include <fcntl.h> // For open
+#include "input.h"
+
+int input_open(struct input *in, const char *file)
+{
+    memset(in, 0, sizeof(*in));
+    if ((in->fd = open(file, O_RDONLY | O_CLOEXEC)) == -1)
+    {
+        fprintf(stderr, "Error: Cannot open '%s'. %s.\n", file, strerror(errno));
+        return -1;
+    }
+    in->own_fd = true;
+    return 0;
+}
+
+void input_fd(struct input *in, int fd)
+{
+    memset(in, 0, sizeof(*in));
+    in->fd = fd;
+}
+
+int input_string(struct input *in, const char *text)
+{
+    memset(in, 0, sizeof(*in));
+    in->fd = -1;
+    in->eof = true;
+    in->end = strlen(text);
+    in->cap = in->end + 1;
+    if (!(in->buf = malloc(in->cap)))
+    {
+        fprintf(stderr, "Error: malloc() failed. %s.\n", strerror(errno));
+        return -1;
+    }
+    memcpy(in->buf, text, in->cap);
+    return 0;
+}
+
+// Appends the next block of the file to buf. Returns -1 on error.
+static int fill(struct input *in)
+{
+    // Move the partial line to the front, and grow only for a line that
+    // does not fit; one byte stays free for the final line's terminator
+    if (in->start > 0)
+    {
+        memmove(in->buf, in->buf + in->start, in->end - in->start);
+        in->end -= in->start;
+        in->start = 0;
+    }
+    if (in->cap - in->end < INPUT_BLOCK + 1)
+    {
+        size_t cap = in->cap ? in->cap * 2 : INPUT_BLOCK + 1;
+        while (cap - in->end < INPUT_BLOCK + 1)
+        {
+            cap *= 2;
+        }
+        char *buf = realloc(in->buf, cap);
+        if (!buf)
+        {
+            fprintf(stderr, "Error: realloc() failed. %s.\n", strerror(errno));
+            return -1;
+        }
+        in->buf = buf;
+        in->cap = cap;
+    }
+
+    ssize_t n;
+    while ((n = read(in->fd, in->buf + in->end, INPUT_BLOCK)) == -1 && errno == EINTR)
+    {
+    }
+    if (n == -1)
+    {
+        fprintf(stderr, "Error: Failed to read input. %s.\n", strerror(errno));
+        return -1;
+    }
+    if (n == 0)
+    {
+        in->eof = true;
+    }
+    in->end += (size_t)n;
+    return 0;
+}
+
+char *input_line(struct input *in)
+{
+    for (;;)
+    {
+        char *line = in->buf + in->start;
+        char *newline = in->start < in->end ? memchr(line, '\n', in->end - in->start) : NULL;
+        if (newline)
+        {
+            *newline = '\0';
+            in->start = (size_t)(newline - in->buf) + 1;
+            return line;
+        }
+        if (in->eof || fill(in) == -1)
+        {
+            in->eof = true;
+            if (in->start == in->end)
+            {
+                return NULL;
+            }
+            line = in->buf + in->start; // Last line, without a newline
+            in->buf[in->end] = '\0';
+            in->start = in->end;
+            return line;
+        }
+    }
+}
+
+void input_close(struct input *in)
+{
+    if (in->own_fd)
+    {
+        close(in->fd);
+    }
+    free(in->buf);
+    in->buf = NULL;
+}
@@ -0,0 +1,38 @@
+#ifndef INPUT_H
+#define INPUT_H
+
+#include <stdbool.h> // For bool
+#include <stddef.h>  // For size_t
+
+#define INPUT_BLOCK 65536 // Bytes asked for by each read() of a script
+
+// Lines of a script file, a -c string or an open descriptor. Files are
+// read in large blocks with read(), not a getline() per line.
+struct input
+{
+    int fd;      // -1 for a string
+    bool own_fd; // Closed by input_close()
+    char *buf;
+    size_t cap;
+    size_t start; // First byte not yet returned
+    size_t end;   // End of the bytes read so far
+    bool eof;
+};
+
+// Reads from file (opened close-on-exec). Returns 0, or -1 (an error has
+// been printed).
+int input_open(struct input *in, const char *file);
+
+// Reads from fd, which is left open
+void input_fd(struct input *in, int fd);
+
+// Reads the lines of text
+int input_string(struct input *in, const char *text);
+
+// Returns the next line without its newline, or NULL at the end. The line
+// may be modified, and is valid until the next call.
+char *input_line(struct input *in);
+
+void input_close(struct input *in);
+
+#endif
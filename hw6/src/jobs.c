@@ -0,0 +1,507 @@
+#define _DEFAULT_SOURCE // For wait4, on top of POSIX.1-2008
+#include "minishell.h"
+#include <ctype.h>        // For isdigit
+#include <termios.h>      // For tcsetpgrp
+#include <sys/resource.h> // For wait4
+#include "jobs.h"
+#include "exec.h"
+
+bool job_control = false;
+
+static bool interactive_shell;
+static pid_t shell_pgid;
+static struct job jobs[MAX_JOBS];
+static int current; // Id of the job fg and bg default to, 0 for none
+
+// The handler only notes that a child changed; the waitpid() calls happen
+// in jobs_reap() at the next prompt or command, outside the handler, so
+// they cannot race with a foreground wait for the same child
+static volatile sig_atomic_t children_changed = 0;
+
+static void sigchld(int sig)
+{
+    (void)sig;
+    children_changed = 1;
+}
+
+void jobs_init(bool interactive)
+{
+    struct sigaction sa;
+    sa.sa_handler = sigchld;
+    sa.sa_flags = SA_RESTART; // Stops are reported too, for bg jobs stopped by SIGTTIN
+    sigemptyset(&sa.sa_mask);
+    if (sigaction(SIGCHLD, &sa, NULL) == -1)
+    {
+        fprintf(stderr, "Error: Cannot register signal handler. %s.\n", strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+
+    interactive_shell = interactive;
+    if (!interactive || !isatty(STDIN_FILENO))
+    {
+        return;
+    }
+    // Run in our own process group and own the terminal; ^Z and reads or
+    // writes while in the background must not stop the shell itself
+    setpgid(0, 0); // Fails harmlessly if we already lead a session
+    shell_pgid = getpgrp();
+    signal(SIGTSTP, SIG_IGN);
+    signal(SIGTTIN, SIG_IGN);
+    signal(SIGTTOU, SIG_IGN);
+    if (tcsetpgrp(STDIN_FILENO, shell_pgid) == -1)
+    {
+        fprintf(stderr, "Error: Cannot take the terminal. %s.\n", strerror(errno));
+        return;
+    }
+    job_control = true;
+}
+
+// The status a shell reports for a waitpid() status
+static int exit_code(int status)
+{
+    return WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+}
+
+static void update_state(struct job *job)
+{
+    bool running = false, stopped = false;
+    for (int i = 0; i < job->count; i++)
+    {
+        if (job->stopped[i])
+        {
+            stopped = true;
+        }
+        else if (!job->done[i])
+        {
+            running = true;
+        }
+    }
+    enum job_state state = stopped ? JOB_STOPPED : running ? JOB_RUNNING : JOB_DONE;
+    if (state != job->state)
+    {
+        job->state = state;
+        job->reported = false;
+    }
+}
+
+bool job_record(pid_t pid, int status, const struct rusage *usage)
+{
+    for (int j = 0; j < MAX_JOBS; j++)
+    {
+        struct job *job = &jobs[j];
+        for (int i = 0; job->id && i < job->count; i++)
+        {
+            if (job->pids[i] != pid)
+            {
+                continue;
+            }
+            if (WIFSTOPPED(status))
+            {
+                job->stopped[i] = true;
+            }
+            else if (WIFCONTINUED(status))
+            {
+                job->stopped[i] = false;
+            }
+            else
+            {
+                job->done[i] = true;
+                job->stopped[i] = false;
+                job->status[i] = status;
+                if (job->timing && usage)
+                {
+                    job->timing->usage[i] = *usage;
+                    job->timing->measured[i] = true;
+                }
+            }
+            update_state(job);
+            return true;
+        }
+    }
+    return false;
+}
+
+void jobs_reap(void)
+{
+    if (!children_changed)
+    {
+        return;
+    }
+    children_changed = 0; // Cleared first: a change during the loop sets it again
+    int status;
+    struct rusage usage;
+    pid_t pid;
+    while ((pid = wait4(-1, &status, WNOHANG | WUNTRACED | WCONTINUED, &usage)) > 0)
+    {
+        job_record(pid, status, &usage);
+    }
+}
+
+static void remove_job(struct job *job)
+{
+    int id = job->id;
+    free(job->text);
+    memset(job, 0, sizeof(*job));
+    if (current == id)
+    {
+        current = 0; // The newest job left takes over
+        for (int j = 0; j < MAX_JOBS; j++)
+        {
+            if (jobs[j].id > current)
+            {
+                current = jobs[j].id;
+            }
+        }
+    }
+}
+
+// The command line of pl, as jobs prints it
+static char *describe(const struct pipeline *pl)
+{
+    char *text = NULL;
+    size_t size;
+    FILE *fp = open_memstream(&text, &size);
+    if (!fp)
+    {
+        return strdup("?");
+    }
+    for (int i = 0; i < pl->count; i++)
+    {
+        const struct command *cmd = &pl->stages[i];
+        fprintf(fp, "%s", i ? " | " : "");
+        for (int a = 0; a < cmd->argc; a++)
+        {
+            fprintf(fp, "%s%s", a ? " " : "", cmd->argv[a]);
+        }
+        if (cmd->input)
+        {
+            fprintf(fp, " < %s", cmd->input);
+        }
+        if (cmd->output)
+        {
+            fprintf(fp, " %s %s", cmd->append ? ">>" : ">", cmd->output);
+        }
+    }
+    fclose(fp);
+    return text;
+}
+
+struct job *job_add(const struct pipeline *pl, const pid_t *pids, pid_t pgid, bool background)
+{
+    struct job *job = NULL;
+    for (int pass = 0; pass < 2 && !job; pass++)
+    {
+        for (int j = 0; j < MAX_JOBS && !job; j++)
+        {
+            if (jobs[j].id == 0)
+            {
+                job = &jobs[j];
+                job->id = j + 1;
+            }
+        }
+        // Scripts keep finished jobs for wait; make room from those
+        for (int j = 0; j < MAX_JOBS && !job; j++)
+        {
+            if (jobs[j].state == JOB_DONE)
+            {
+                remove_job(&jobs[j]);
+            }
+        }
+    }
+    if (!job)
+    {
+        fprintf(stderr, "Error: Too many jobs.\n");
+        return NULL;
+    }
+
+    job->pgid = pgid;
+    job->count = pl->count;
+    job->background = background;
+    job->text = describe(pl);
+    for (int i = 0; i < pl->count; i++)
+    {
+        job->pids[i] = pids[i];
+        if (pids[i] == -1)
+        {
+            job->done[i] = true;
+            job->status[i] = 127 << 8; // As a shell reports a command that could not run
+        }
+    }
+    job->state = JOB_RUNNING;
+    update_state(job);
+    if (background)
+    {
+        current = job->id;
+        if (interactive_shell)
+        {
+            printf("[%d] %d\n", job->id, (int)pids[pl->count - 1]);
+        }
+    }
+    return job;
+}
+
+static void print_job(const struct job *job)
+{
+    char state[32];
+    int status = job->status[job->count - 1];
+    if (job->state == JOB_RUNNING)
+    {
+        snprintf(state, sizeof(state), "Running");
+    }
+    else if (job->state == JOB_STOPPED)
+    {
+        snprintf(state, sizeof(state), "Stopped");
+    }
+    else if (WIFSIGNALED(status))
+    {
+        snprintf(state, sizeof(state), "%s", strsignal(WTERMSIG(status)));
+    }
+    else if (WEXITSTATUS(status))
+    {
+        snprintf(state, sizeof(state), "Exit %d", WEXITSTATUS(status));
+    }
+    else
+    {
+        snprintf(state, sizeof(state), "Done");
+    }
+    printf("[%d]%c  %-24s%s%s\n", job->id, job->id == current ? '+' : ' ', state, job->text,
+           job->state == JOB_RUNNING ? " &" : "");
+}
+
+// Waits until every command of job has finished, or one has stopped
+static void wait_job(struct job *job)
+{
+    for (int i = 0; i < job->count && job->state != JOB_STOPPED; i++)
+    {
+        while (!job->done[i] && !job->stopped[i])
+        {
+            int status;
+            struct rusage usage;
+            if (wait4(job->pids[i], &status, WUNTRACED, &usage) == -1)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                fprintf(stderr, "Error: wait4() failed. %s.\n", strerror(errno));
+                status = EXIT_FAILURE << 8;
+                job_record(job->pids[i], status, NULL);
+                continue;
+            }
+            job_record(job->pids[i], status, &usage);
+        }
+    }
+}
+
+void job_terminal(pid_t pgid)
+{
+    if (job_control)
+    {
+        tcsetpgrp(STDIN_FILENO, pgid ? pgid : shell_pgid);
+    }
+}
+
+void job_foreground(struct job *job, bool resume)
+{
+    if (job->pgid > 0)
+    {
+        job_terminal(job->pgid);
+    }
+    if (resume && job->state == JOB_STOPPED)
+    {
+        for (int i = 0; i < job->count; i++)
+        {
+            if (!job->done[i])
+            {
+                kill(job->pids[i], SIGCONT);
+                job->stopped[i] = false;
+            }
+        }
+        update_state(job);
+    }
+    job->background = false;
+
+    wait_job(job);
+
+    job_terminal(0);
+    if (job->state == JOB_STOPPED)
+    {
+        if (job->timing)
+        {
+            job->timing->stopped = true;
+        }
+        job->timing = NULL; // Only measured while in the foreground
+        current = job->id;
+        job->background = true;
+        job->reported = true;
+        putchar('\n');
+        print_job(job);
+        last_status = 128 + SIGTSTP;
+        return;
+    }
+    // The pipeline's status is the last command's
+    last_status = exit_code(job->status[job->count - 1]);
+    remove_job(job);
+}
+
+void jobs_notify(void)
+{
+    jobs_reap();
+    for (int j = 0; j < MAX_JOBS; j++)
+    {
+        struct job *job = &jobs[j];
+        if (job->id && job->background && !job->reported && job->state != JOB_RUNNING)
+        {
+            print_job(job);
+            job->reported = true;
+            if (job->state == JOB_DONE)
+            {
+                remove_job(job);
+            }
+        }
+    }
+    fflush(stdout);
+}
+
+// Finds the job named by spec: %N or N is job N, %% or %+ (or no spec) the
+// current job. With pids, a plain number is a process id instead.
+static struct job *find_job(const char *spec, bool pids, const char *builtin)
+{
+    int id = current;
+    if (spec && strcmp(spec, "%%") != 0 && strcmp(spec, "%+") != 0)
+    {
+        const char *digits = spec[0] == '%' ? spec + 1 : spec;
+        char *end;
+        long n = strtol(digits, &end, 10);
+        if (!isdigit((unsigned char)*digits) || *end)
+        {
+            fprintf(stderr, "Error: %s: %s: no such job.\n", builtin, spec);
+            return NULL;
+        }
+        if (pids && spec[0] != '%')
+        {
+            for (int j = 0; j < MAX_JOBS; j++)
+            {
+                for (int i = 0; jobs[j].id && i < jobs[j].count; i++)
+                {
+                    if (jobs[j].pids[i] == (pid_t)n)
+                    {
+                        return &jobs[j];
+                    }
+                }
+            }
+            fprintf(stderr, "Error: %s: pid %ld is not a child of this shell.\n", builtin, n);
+            return NULL;
+        }
+        id = n > 0 && n <= MAX_JOBS ? (int)n : 0;
+    }
+    if (id == 0 || jobs[id - 1].id == 0)
+    {
+        fprintf(stderr, "Error: %s: %s: no such job.\n", builtin, spec ? spec : "current");
+        return NULL;
+    }
+    return &jobs[id - 1];
+}
+
+int builtin_jobs(int argc, char **argv)
+{
+    (void)argc;
+    (void)argv;
+    jobs_reap();
+    for (int j = 0; j < MAX_JOBS; j++)
+    {
+        struct job *job = &jobs[j];
+        if (job->id && job->background)
+        {
+            print_job(job);
+            job->reported = true;
+            if (job->state == JOB_DONE && interactive_shell)
+            {
+                remove_job(job); // Reported now, so not again at the prompt
+            }
+        }
+    }
+    return EXIT_SUCCESS;
+}
+
+// wait [job...]: waits for the given jobs (or all of them) and returns
+// the status of the last one
+int builtin_wait(int argc, char **argv)
+{
+    int status = EXIT_SUCCESS;
+    if (argc == 1)
+    {
+        for (int j = 0; j < MAX_JOBS; j++)
+        {
+            if (jobs[j].id && jobs[j].state == JOB_RUNNING)
+            {
+                wait_job(&jobs[j]);
+            }
+            if (jobs[j].id && jobs[j].state == JOB_DONE)
+            {
+                remove_job(&jobs[j]);
+            }
+        }
+        return status;
+    }
+    for (int a = 1; a < argc; a++)
+    {
+        struct job *job = find_job(argv[a], true, "wait");
+        if (!job)
+        {
+            status = 127;
+            continue;
+        }
+        wait_job(job);
+        if (job->state == JOB_DONE)
+        {
+            status = exit_code(job->status[job->count - 1]);
+            remove_job(job);
+        }
+        else
+        {
+            status = 128 + SIGTSTP;
+        }
+    }
+    return status;
+}
+
+int builtin_fg(int argc, char **argv)
+{
+    struct job *job = find_job(argc > 1 ? argv[1] : NULL, false, "fg");
+    if (!job)
+    {
+        return EXIT_FAILURE;
+    }
+    printf("%s\n", job->text);
+    fflush(stdout);
+    job_foreground(job, true);
+    return last_status;
+}
+
+int builtin_bg(int argc, char **argv)
+{
+    struct job *job = find_job(argc > 1 ? argv[1] : NULL, false, "bg");
+    if (!job)
+    {
+        return EXIT_FAILURE;
+    }
+    if (job->state != JOB_STOPPED)
+    {
+        fprintf(stderr, "Error: bg: job %d is not stopped.\n", job->id);
+        return EXIT_FAILURE;
+    }
+    for (int i = 0; i < job->count; i++)
+    {
+        if (!job->done[i])
+        {
+            kill(job->pids[i], SIGCONT);
+            job->stopped[i] = false;
+        }
+    }
+    job->background = true;
+    update_state(job);
+    current = job->id;
+    printf("[%d]+ %s &\n", job->id, job->text);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,71 @@
+#ifndef JOBS_H
+#define JOBS_H
+
+#include <stdbool.h>   // For bool
+#include <sys/types.h> // For pid_t
+#include "parse.h"
+#include "timing.h"
+
+#define MAX_JOBS 64 // Most jobs in the job table
+
+enum job_state
+{
+    JOB_RUNNING,
+    JOB_STOPPED,
+    JOB_DONE,
+};
+
+struct job
+{
+    int id;               // 0 for a free slot
+    pid_t pgid;           // 0 without job control
+    pid_t pids[MAX_PIPE]; // -1 for a command that did not start
+    int status[MAX_PIPE]; // waitpid() status of each finished command
+    bool done[MAX_PIPE];
+    bool stopped[MAX_PIPE];
+    int count;
+    enum job_state state;
+    bool background;
+    bool reported; // Its current state has been printed
+    char *text;    // The command line, for jobs and notifications
+    struct timing *timing; // Gets each command's rusage while timed, or NULL
+};
+
+// True when the shell is interactive on a terminal: every pipeline then
+// gets its own process group, and the terminal goes to the foreground one
+extern bool job_control;
+
+// Installs the SIGCHLD handler, and takes the terminal for job control if
+// interactive and stdin is one
+void jobs_init(bool interactive);
+
+// Records a started pipeline. Returns the job, or NULL if the table is
+// full (an error has been printed).
+struct job *job_add(const struct pipeline *pl, const pid_t *pids, pid_t pgid, bool background);
+
+// Under job control, makes process group pgid (the shell's own if 0) the
+// terminal's foreground group
+void job_terminal(pid_t pgid);
+
+// Waits in the foreground until the job ends or is stopped, first sending
+// it SIGCONT if resume. Sets last_status.
+void job_foreground(struct job *job, bool resume);
+
+// Stores a wait status (and the rusage from wait4(), if not NULL) for
+// pid, for callers that wait for any child themselves. Returns false if
+// pid is no job's.
+bool job_record(pid_t pid, int status, const struct rusage *usage);
+
+// Collects the status of children that changed since SIGCHLD last arrived
+void jobs_reap(void);
+
+// Prints and drops the background jobs that have finished since the last
+// prompt, and reports newly stopped ones
+void jobs_notify(void);
+
+int builtin_jobs(int argc, char **argv);
+int builtin_wait(int argc, char **argv);
+int builtin_fg(int argc, char **argv);
+int builtin_bg(int argc, char **argv);
+
+#endif
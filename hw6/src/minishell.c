@@ -1,9 +1,9 @@
 #define _POSIX_C_SOURCE 200809L
-#define MAX_LINE 4096
-#define MAX_TOKEN 2048
-#define MAX_PIPE 64
 #include "minishell.h"
 #include "parse.h"
+#include "exec.h"
+#include "input.h"
+#include "jobs.h"
 
 volatile sig_atomic_t interrupted = 0; // Tracks if SIGINT was received
 
@@ -41,14 +41,28 @@ void clp_writer(void)
     fflush(stdout); // Flush stdout to ensure the prompt is printed immediately
 }
 
-void builtin_exit(int argc, char **argv)
+// exit [status]; without one, exits with the last command's status as sh does
+int builtin_exit(int argc, char **argv)
 {
-    if (argc > 1)
+    int status = last_status;
+    if (argc > 2)
     {
-        fprintf(stderr, "Error: exit takes no arguments.\n");
-        return; // QUESTION: if exit() improperly called, should we return or exit?
+        fprintf(stderr, "Error: Too many arguments to exit.\n");
+        return EXIT_FAILURE; // QUESTION: if exit() improperly called, should we return or exit?
     }
-    exit(EXIT_SUCCESS);
+    if (argc == 2)
+    {
+        char *end;
+        long value = strtol(argv[1], &end, 10);
+        if (end == argv[1] || *end)
+        {
+            fprintf(stderr, "Error: exit: numeric argument required: %s\n", argv[1]);
+            return EXIT_FAILURE;
+        }
+        status = (int)(value & 0xff);
+    }
+    fflush(stdout); // exit() may be running with stdout redirected
+    exit(status);
 }
 
 //
@@ -70,176 +84,169 @@ static const char *get_home(void)
     return pw->pw_dir; // Return the home directory
 }
 
-static char *tilde_expansion(const char *arg)
-{
-    if (!arg)
-    {
-        fprintf(stderr, "Error: NULL argument passed to tilde_expansion.\n");
-        return NULL;
-    }
-
-    if (arg[0] != '~')
-    {
-        return strdup(arg); // If the first character is not ~, return a copy of the string
-    }
-    const char *home = get_home(); // Get the home directory
-    if (!home)                     // Check if home is NULL/empty
-    {
-        fprintf(stderr, "Error: Cannot get to home folder.\n");
-        return NULL;
-    }
-
-    size_t length = strlen(home) + strlen(arg); // Calculate the length of the new string
-    // Why do we to do that? How does strlen handle slashes, tildes, etc.?
-    char *output = malloc(length); // Allocate memory for the new string
-    if (!output)
-    {
-        fprintf(stderr, "Error: malloc() failed. %s.\n", strerror(errno));
-        return NULL;
-    }
-    // The +1 skips the tilde character; sprint writes to the output buffer
-    snprintf(output, length, "%s%s", home, arg + 1); // Copy the home directory and the rest of the string
-
-    return output; // Return the new string
-}
-
-void builtin_cd(int argc, char **argv)
+// The lexer has already removed quotes and expanded ~, so the argument is
+// the directory as it is
+int builtin_cd(int argc, char **argv)
 {
-    const char *target;    // The target directory to change to
-    int free_sentinel = 0; // Flag to indicate if we need to free the target
+    const char *target; // The target directory to change to
 
-    // Case 1: No arguments or tilde-only, change to home directory
-    if (argc == 1 || (argc == 2 && strcmp(argv[1], "~") == 0))
+    // Case 1: No arguments, change to home directory
+    if (argc == 1)
     {
         target = get_home(); // Get the home directory
         if (!target)
         {
-            return;
+            return EXIT_FAILURE;
         }
     }
     // Case 2: Target given
     else if (argc == 2)
     {
-        // Check if the argument is quoted
-        char *quote_checked = quoted_helper(argv[1]);
-        if (!quote_checked)
-        {
-            return; // Check if processing failed
-        }
-
-        // if (quote_checked[0] == '~')
-        //{
-        target = tilde_expansion(quote_checked); // Check for tilde expansion on processed string
-        if (!target)
-        {
-            fprintf(stderr, "Error: Failed to expand path: %s\n", argv[1]);
-            free(quote_checked); // Free the processed string
-            return;              // Check if tilde expansion failed
-        }
-        //}
-
-        free_sentinel = 1; // Set the flag to free the target later
+        target = argv[1];
     }
     // Case 3: Too many arguments
     else
     {
         fprintf(stderr, "Error: Too many arguments to cd.\n");
-        return;
+        return EXIT_FAILURE;
     }
     // Change to the target directory
     if (chdir(target) == -1)
     {
         fprintf(stderr, "Error: Cannot change directory to '%s'. %s.\n", target, strerror(errno));
-        return;
+        return EXIT_FAILURE;
     }
+    return EXIT_SUCCESS;
+}
 
-    // if (target != argv[1])
-    //     free((void *)target); // Free if we malloc'd;
-    //  Do we need (void *)target? —> Yes, to tell compiler we intentionally discard the const qualifer
-    if (free_sentinel)
+static struct lexer lexer;    // Kept from line to line: no allocation once warmed up
+static struct line_list list; // Likewise
+
+// True if the pipeline's text starts with the word time, unquoted: as in
+// sh, a quoted "time" (or one from an expansion) is an ordinary command
+static bool starts_with_time(const char *text)
+{
+    while (*text == ' ' || *text == '\t')
     {
-        free((void *)target); // Free the expanded string if we allocated it
+        text++;
     }
+    return strncmp(text, "time", 4) == 0 && (text[4] == '\0' || strchr(" \t|<>;&", text[4]));
 }
 
-char *quoted_helper(const char *arg)
+// Runs one line of input: pipelines joined by ;, &, && and ||. The whole
+// line is checked first, so a syntax error anywhere runs none of it; each
+// pipeline is then expanded only when its turn comes and it is to run.
+static void run_line(const char *line)
 {
-    size_t length = strlen(arg); // Get the length of the string
-
-    if (length >= 2 && arg[0] == '"' && arg[length - 1] == '"')
+    if (parse_list(line, &list) == -1)
+    {
+        last_status = 2; // A syntax error, as sh reports it
+        return;
+    }
+    enum list_op op = LIST_SEQ; // How the previous pipeline ended
+    for (size_t i = 0; i < list.count; i++)
     {
+        enum list_op next = list.items[i].op;
 
-        // Check if the line starts and ends with double quotes
-        char *output = malloc(length - 1); // Allocate memory for the new string
-        if (!output)
+        // && and || skip a pipeline based on the status so far; a skipped
+        // one passes that status on, so a || b && c works left to right
+        bool run = op == LIST_SEQ || op == LIST_BACKGROUND || (op == LIST_AND) == (last_status == 0);
+        op = next;
+        if (!run)
         {
-            fprintf(stderr, "Error: malloc() failed. %s.\n", strerror(errno));
-            return NULL;
+            continue;
         }
 
-        strncpy(output, arg + 1, length - 2); // Copy the string without the quotes
-        output[length - 2] = '\0';            // Null-terminate the string
-        return output;                        // Return the new string
-    }
+        const char *text = list.items[i].start;
+        int argc = line_splitter(&lexer, &text, &next); // Call function from parse.c
+        char **item = lexer.argv;
+        if (argc == -1)
+        {
+            last_status = 2; // A bad substitution
+            return;
+        }
+        if (argc == 0)
+        {
+            last_status = EXIT_SUCCESS; // Every word expanded to nothing
+            continue;
+        }
 
-    if (strchr(arg, '"'))
-    {
-        // If there is quote in the string but doesn't start and end with it
-        fprintf(stderr, "Error: Mismatched or missing quotes in argument: %s\n", arg);
-        return NULL;
-    }
+        // time [-p] before a pipeline times all of it
+        struct timing timing;
+        bool timed = false, posix = false;
+        int skip = 0;
+        if (strcmp(item[0], "time") == 0 && starts_with_time(list.items[i].start))
+        {
+            timed = true;
+            posix = argc > 1 && strcmp(item[1], "-p") == 0;
+            skip = 1 + posix;
+        }
 
-    // If no quotes, return a copy of the argument
-    return strdup(arg);
+        // Split into the commands of a pipeline: a | b | c > out
+        struct pipeline pl;
+        if (parse_pipeline(item + skip, argc - skip, &pl) == -1)
+        {
+            last_status = 2;
+            return;
+        }
+        jobs_reap(); // Keep the job table current between commands
+        if (timed)
+        {
+            timing_start(&timing, pl.count);
+        }
+        // Builtins (cd, exit, echo, ...) are found and run by execute_pipeline()
+        execute_pipeline(&pl, next == LIST_BACKGROUND, timed ? &timing : NULL);
+        if (timed && next != LIST_BACKGROUND && !timing.stopped)
+        {
+            timing.end = timing_now();
+            timing_report(&timing, &pl, posix);
+        }
+    }
 }
 
-void execute_command(int argc, char **argv)
+// Runs a script file, or the text given with -c, without prompts.
+// Returns the status of the last command.
+static int run_script(const char *file, const char *text)
 {
-    // Check for too many tokens
-    if (argc > MAX_TOKEN)
+    jobs_init(false);
+    struct input in;
+    if ((file ? input_open(&in, file) : input_string(&in, text)) == -1)
     {
-        fprintf(stderr, "Error: Too many arguments.\n");
-        return;
+        return file ? 127 : EXIT_FAILURE;
     }
-
-    // Check for command length exceeding limit
-    if (strlen(argv[0]) > MAX_LINE)
+    char *line;
+    while ((line = input_line(&in)) != NULL)
     {
-        fprintf(stderr, "Error: Command too long.\n");
-        return;
+        run_line(line);
     }
-    pid_t pid = fork();
-    if (pid == -1)
+    input_close(&in);
+    lexer_free(&lexer);
+    line_list_free(&list);
+    return last_status;
+}
+
+int main(int argc, char **argv)
+{
+    // minishell -c 'commands', or minishell script
+    if (argc >= 3 && strcmp(argv[1], "-c") == 0)
     {
-        fprintf(stderr, "Error: fork() failed. %s.\n", strerror(errno));
-        return;
+        return run_script(NULL, argv[2]);
     }
-    if (pid == 0)
+    if (argc == 2 && strcmp(argv[1], "-c") == 0)
     {
-        execvp(argv[0], argv); // Child process executes the command
-        fprintf(stderr, "Error: exec() failed. %s.\n", strerror(errno));
-        // fprintf(stderr, "Error: Command not found: %s\n", argv[0]);
-        exit(EXIT_FAILURE);
+        fprintf(stderr, "Error: -c requires an argument.\n");
+        return 2;
     }
-    else if (pid > 0)
-    { // Parent process
-        int status;
-        waitpid(pid, &status, 0);
-    }
-    else
+    if (argc >= 2)
     {
-        // Fork failed
-        perror("Error: Failed to fork");
+        return run_script(argv[1], NULL);
     }
-}
-
-int main(void)
-{
 
     char *line = NULL; // we will use getline() to malloc here
     size_t cap = 0;    // size_t is an unsigned type; getline grows the buffer, we need to track
     ssize_t length;    // the length of the line returned by getline()
     signalhandler();   // Register the SIGINT handler
+    jobs_init(true);   // SIGCHLD handler, and job control on a terminal
 
     // Begin a loop
     for (;;)
@@ -250,7 +257,8 @@ int main(void)
             // printf("minishell$ ");
             fflush(stdout);
         }
-        clp_writer(); // Print the command line prompt
+        jobs_notify(); // Report background jobs that finished
+        clp_writer();  // Print the command line prompt
 
         length = getline(&line, &cap, stdin); // Read a line from stdin
         if (length == -1)
@@ -277,32 +285,13 @@ int main(void)
             continue; // Skip empty lines
         }
 
-        // TODO: Implement the command parsing and execution logic here
-        // Tokenizing the input to process commmands and arguments
-
-        char *argv[MAX_TOKEN];                           // Array to hold the arguments
-        int argc = line_splitter(line, argv, MAX_TOKEN); // Call function from parse.c
-
-        if (argc == 0)
-        {
-            continue; // Skip empty lines
-        }
-        if (strcmp(argv[0], "exit") == 0)
-        {
-            builtin_exit(argc, argv); // Check for the exit command
-        }
-        else if (strcmp(argv[0], "cd") == 0)
-        {
-            builtin_cd(argc, argv); // Check for the cd command
-        }
-        else
-        {
-            execute_command(argc, argv); // Execute the command
-        }
+        run_line(line);
 
         // Debug Helper
         // printf("DEBUGGER: You typed: «%s» \n", line);
     }
     free(line);          // Free the allocated memory for the line
-    return EXIT_SUCCESS; // Return success
+    lexer_free(&lexer);
+    line_list_free(&list);
+    return last_status;  // Exit with the last command's status, as sh does
 }
@@ -18,9 +18,8 @@
 
 // This helps deal with fatal errors, without having to register exit
 void fatal(const char *msg);
-void builtin_exit(int argc, char **argv);
-void builtin_cd(int argc, char **argv);
+int builtin_exit(int argc, char **argv);
+int builtin_cd(int argc, char **argv);
 void clp_writer(void);
-char *quoted_helper(const char *arg);
 
 #endif
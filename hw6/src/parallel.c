@@ -0,0 +1,318 @@
+#define _POSIX_C_SOURCE 200809L
+#include <fcntl.h> // For fcntl
+#include "minishell.h"
+#include "parallel.h"
+#include "exec.h"
+#include "input.h"
+#include "jobs.h"
+
+// One run of the command
+struct task
+{
+    pid_t pid;
+    FILE *out; // With -k: holds the output until it is its turn
+    int status;
+    bool done;
+};
+
+struct parallel
+{
+    char **command; // Template, up to ::: (not NULL-terminated)
+    int ncommand;
+    bool placeholder; // Some word of the command contains {}
+    char **inputs;    // After ::: (NULL to read stdin)
+    int ninputs;
+    struct input in; // stdin, when there is no :::
+    int next_input;
+
+    struct task *tasks;
+    int ntasks;
+    int cap;
+    int printed; // With -k: tasks before this one have been printed
+};
+
+// Returns the next input, or NULL when there are no more
+static char *next_input(struct parallel *par)
+{
+    if (par->inputs)
+    {
+        return par->next_input < par->ninputs ? par->inputs[par->next_input++] : NULL;
+    }
+    char *line;
+    while ((line = input_line(&par->in)) != NULL && *line == '\0')
+    {
+    }
+    return line;
+}
+
+// Copies word with every {} replaced by input, or NULL on failure
+static char *substitute(const char *word, const char *input)
+{
+    size_t input_len = strlen(input), len = 0;
+    for (const char *p = word; *p; p++, len++)
+    {
+        if (p[0] == '{' && p[1] == '}')
+        {
+            len += input_len - 1;
+            p++;
+        }
+    }
+    char *out = malloc(len + 1);
+    if (!out)
+    {
+        fprintf(stderr, "Error: malloc() failed. %s.\n", strerror(errno));
+        return NULL;
+    }
+    char *q = out;
+    for (const char *p = word; *p; p++)
+    {
+        if (p[0] == '{' && p[1] == '}')
+        {
+            memcpy(q, input, input_len);
+            q += input_len;
+            p++;
+        }
+        else
+        {
+            *q++ = *p;
+        }
+    }
+    *q = '\0';
+    return out;
+}
+
+// Starts the command for input as a new task. A run that cannot start
+// becomes a finished task with status 127.
+static int start_task(struct parallel *par, const char *input, bool keep)
+{
+    if (par->ntasks == par->cap)
+    {
+        int cap = par->cap ? par->cap * 2 : 64;
+        struct task *tasks = realloc(par->tasks, (size_t)cap * sizeof(*tasks));
+        if (!tasks)
+        {
+            fprintf(stderr, "Error: realloc() failed. %s.\n", strerror(errno));
+            return -1;
+        }
+        par->tasks = tasks;
+        par->cap = cap;
+    }
+    struct task *task = &par->tasks[par->ntasks++];
+    memset(task, 0, sizeof(*task));
+    task->pid = -1;
+    task->status = 127 << 8;
+    task->done = true;
+
+    char **argv = malloc((size_t)(par->ncommand + 2) * sizeof(*argv));
+    if (!argv)
+    {
+        fprintf(stderr, "Error: malloc() failed. %s.\n", strerror(errno));
+        return -1;
+    }
+    bool built = true;
+    int argc = 0;
+    for (int i = 0; i < par->ncommand; i++)
+    {
+        argv[argc] = par->placeholder ? substitute(par->command[i], input) : par->command[i];
+        built = built && argv[argc++];
+    }
+    if (!par->placeholder)
+    {
+        argv[argc++] = (char *)input;
+    }
+    argv[argc] = NULL;
+
+    // The output goes to an unlinked temporary file rather than a pipe, so
+    // nothing has to drain it while the run goes on. Close-on-exec keeps
+    // it out of the other runs (the spawn dup2()s it onto stdout).
+    if (keep && !(task->out = tmpfile()))
+    {
+        fprintf(stderr, "Error: Cannot create temporary file. %s.\n", strerror(errno));
+    }
+    else if (task->out && fcntl(fileno(task->out), F_SETFD, FD_CLOEXEC) == -1)
+    {
+        fprintf(stderr, "Error: fcntl() failed. %s.\n", strerror(errno));
+    }
+    else if (built)
+    {
+        task->pid = spawn_command(argv, task->out ? fileno(task->out) : -1, !par->inputs);
+        task->done = task->pid == -1;
+    }
+
+    for (int i = 0; par->placeholder && i < par->ncommand; i++)
+    {
+        free(argv[i]);
+    }
+    free(argv);
+    return 0;
+}
+
+// Prints the kept output of every finished task whose predecessors have
+// all been printed
+static void print_ready(struct parallel *par)
+{
+    char buffer[65536];
+    for (; par->printed < par->ntasks && par->tasks[par->printed].done; par->printed++)
+    {
+        FILE *out = par->tasks[par->printed].out;
+        if (!out)
+        {
+            continue;
+        }
+        rewind(out);
+        size_t n;
+        while ((n = fread(buffer, 1, sizeof(buffer), out)) > 0)
+        {
+            fwrite(buffer, 1, n, stdout);
+        }
+        fclose(out);
+        par->tasks[par->printed].out = NULL;
+    }
+    fflush(stdout);
+}
+
+// Waits for any child: whichever run ends first frees its slot. Returns 1
+// if it was one of our runs, 0 if not, and -1 on failure.
+static int wait_task(struct parallel *par, bool *interrupted)
+{
+    int status;
+    pid_t pid = waitpid(-1, &status, 0);
+    if (pid == -1)
+    {
+        if (errno == EINTR)
+        {
+            return 0;
+        }
+        fprintf(stderr, "Error: waitpid() failed. %s.\n", strerror(errno));
+        return -1;
+    }
+    for (int t = par->ntasks - 1; t >= 0; t--)
+    {
+        struct task *task = &par->tasks[t];
+        if (task->pid == pid && !task->done)
+        {
+            task->status = status;
+            task->done = true;
+            // ^C reached the runs too; do not start any more
+            *interrupted = *interrupted || (WIFSIGNALED(status) && WTERMSIG(status) == SIGINT);
+            return 1;
+        }
+    }
+    job_record(pid, status, NULL); // A background job, which we reaped for the job table
+    return 0;
+}
+
+int builtin_parallel(int argc, char **argv)
+{
+    long jobs = sysconf(_SC_NPROCESSORS_ONLN);
+    bool keep = false;
+    int i = 1;
+    for (; i < argc && argv[i][0] == '-'; i++)
+    {
+        if (strcmp(argv[i], "-k") == 0)
+        {
+            keep = true;
+        }
+        else if (strncmp(argv[i], "-j", 2) == 0)
+        {
+            const char *value = argv[i][2] ? argv[i] + 2 : i + 1 < argc ? argv[++i] : "";
+            char *end;
+            jobs = strtol(value, &end, 10);
+            if (end == value || *end || jobs < 1)
+            {
+                fprintf(stderr, "Error: parallel: -j needs a positive number.\n");
+                return 2;
+            }
+        }
+        else if (strcmp(argv[i], "--") == 0)
+        {
+            i++;
+            break;
+        }
+        else
+        {
+            fprintf(stderr, "Error: parallel: unknown option %s.\n", argv[i]);
+            return 2;
+        }
+    }
+    jobs = jobs < 1 ? 1 : jobs;
+
+    struct parallel par = {.command = argv + i};
+    while (i < argc && strcmp(argv[i], ":::") != 0)
+    {
+        par.placeholder = par.placeholder || strstr(argv[i], "{}");
+        par.ncommand++;
+        i++;
+    }
+    if (par.ncommand == 0)
+    {
+        fprintf(stderr, "Usage: parallel [-j N] [-k] command [arg...] [::: input...]\n");
+        return 2;
+    }
+    if (i < argc)
+    {
+        par.inputs = argv + i + 1;
+        par.ninputs = argc - i - 1;
+    }
+    else
+    {
+        input_fd(&par.in, STDIN_FILENO);
+    }
+
+    int running = 0;
+    bool stop = false;
+    for (;;)
+    {
+        if (keep)
+        {
+            print_ready(&par);
+        }
+        // With -k a run's output is held until the runs before it are
+        // printed; launching pauses while as many runs hold output as may
+        // run at once, so a slow run cannot pile up open files behind it
+        char *input;
+        while (!stop && running < jobs && (!keep || par.ntasks - par.printed < 2 * jobs) &&
+               (input = next_input(&par)) != NULL)
+        {
+            if (start_task(&par, input, keep) == -1)
+            {
+                stop = true;
+                break;
+            }
+            running += !par.tasks[par.ntasks - 1].done;
+        }
+        if (running == 0)
+        {
+            if (keep && par.printed < par.ntasks)
+            {
+                continue; // Runs that could not start: print them and go on
+            }
+            break;
+        }
+        int finished = wait_task(&par, &stop);
+        if (finished == -1)
+        {
+            break;
+        }
+        running -= finished;
+    }
+
+    int status = EXIT_SUCCESS;
+    for (int t = 0; t < par.ntasks; t++)
+    {
+        if (par.tasks[t].out)
+        {
+            fclose(par.tasks[t].out); // Only left behind after an error
+        }
+        if (par.tasks[t].status != 0)
+        {
+            status = EXIT_FAILURE;
+        }
+    }
+    if (!par.inputs)
+    {
+        input_close(&par.in);
+    }
+    free(par.tasks);
+    return status;
+}
@@ -0,0 +1,12 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+// parallel [-j N] [-k] command [arg...] [::: input...]
+// Runs command once per input (the arguments after :::, or else the lines
+// of stdin), at most N at a time (default: one per CPU). Each {} in the
+// command is replaced by the input; without one the input is appended.
+// With -k the output of each run is kept together and printed in input
+// order. Returns 0 if every run succeeded.
+int builtin_parallel(int argc, char **argv);
+
+#endif
@@ -1,73 +1,617 @@
+#define _POSIX_C_SOURCE 200809L
 #include <string.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <stdlib.h> // For getenv, realloc
+#include <unistd.h> // For getpid, getuid
+#include <ctype.h>  // For isalpha, isdigit
+#include <errno.h>  // For errno
+#include <pwd.h>    // For getpwnam, getpwuid
+#include "parse.h"
+#include "exec.h"
+#include "glob.h"
 
-int line_splitter(char *line, char **argv, int max)
+// Operator tokens. line_splitter() hands out these very pointers, which is
+// how parse_pipeline() tells an operator from a quoted argument.
+static char op_pipe[] = "|";
+static char op_input[] = "<";
+static char op_output[] = ">";
+static char op_append[] = ">>";
+static char op_seq[] = ";";
+static char op_and[] = "&&";
+static char op_or[] = "||";
+static char op_background[] = "&";
+
+// Returns the operator token line starts with (and its length), or NULL
+static char *match_operator(const char *line, int *length)
+{
+    *length = 1;
+    switch (*line)
+    {
+    case '|':
+        if (line[1] == '|')
+        {
+            *length = 2;
+            return op_or;
+        }
+        return op_pipe;
+    case ';':
+        return op_seq;
+    case '&':
+        if (line[1] == '&')
+        {
+            *length = 2;
+            return op_and;
+        }
+        return op_background;
+    case '<':
+        return op_input;
+    case '>':
+        if (line[1] == '>')
+        {
+            *length = 2;
+            return op_append;
+        }
+        return op_output;
+    default:
+        return NULL;
+    }
+}
+
+static bool is_operator(const char *token)
+{
+    return token == op_pipe || token == op_input || token == op_output || token == op_append || token == op_seq ||
+           token == op_and || token == op_or || token == op_background;
+}
+
+// The list_op an operator token stands for (LIST_END if it is none)
+static enum list_op list_operator(const char *token)
+{
+    return token == op_seq ? LIST_SEQ
+           : token == op_and ? LIST_AND
+           : token == op_or ? LIST_OR
+           : token == op_background ? LIST_BACKGROUND
+                                    : LIST_END;
+}
+
+// Appends a word to the lexer's argv, growing it only past its largest size
+static int add_word(struct lexer *lexer, int argc, char *word)
+{
+    if ((size_t)argc + 2 > lexer->cap)
+    {
+        size_t cap = lexer->cap ? lexer->cap * 2 : 64;
+        char **argv = realloc(lexer->argv, cap * sizeof(*argv));
+        if (!argv)
+        {
+            fprintf(stderr, "Error: realloc() failed. %s.\n", strerror(errno));
+            return -1;
+        }
+        lexer->argv = argv;
+        lexer->cap = cap;
+    }
+    lexer->argv[argc] = word;
+    return 0;
+}
+
+// Where glob_expand() puts its matches: the next words of the lexer
+struct glob_words
+{
+    struct lexer *lexer;
+    int argc;
+};
+
+static int add_match(void *ctx, char *path)
+{
+    struct glob_words *words = ctx;
+    return add_word(words->lexer, words->argc++, path);
+}
+
+static int compare_words(const void *a, const void *b)
+{
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+// Appends a character that was quoted or came from an expansion. Glob
+// characters (and backslashes) get a backslash, so that only unquoted
+// ones take effect; *escaped records that the word needs unescaping.
+static int put_quoted(struct lexer *lexer, char c, bool *escaped)
+{
+    if (c == '\\' || c == '*' || c == '?' || c == '[')
+    {
+        *escaped = true;
+        if (arena_putc(&lexer->arena, '\\') == -1)
+        {
+            return -1;
+        }
+    }
+    return arena_putc(&lexer->arena, c);
+}
+
+static int put_quoted_string(struct lexer *lexer, const char *s, bool *escaped)
+{
+    for (; *s; s++)
+    {
+        if (put_quoted(lexer, *s, escaped) == -1)
+        {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static bool is_name_char(char c, bool first)
+{
+    return c == '_' || isalpha((unsigned char)c) || (!first && isdigit((unsigned char)c));
+}
+
+// Expands the $ at *p ($NAME, ${NAME}, $? or $$) onto the word being built,
+// advancing *p past it. A $ that starts none of these is kept as it is.
+static int expand_dollar(struct lexer *lexer, const char **p, bool *escaped)
 {
-    int argc = 0; // Number of arg
-    char *token = line;
+    const char *s = *p + 1;
+    char number[24];
+    const char *value = NULL;
 
-    while (*token && argc < max - 1)
+    if (*s == '?' || *s == '$')
+    {
+        snprintf(number, sizeof(number), "%d", *s == '?' ? last_status : (int)getpid());
+        value = number;
+        s++;
+    }
+    else if (*s == '{' || is_name_char(*s, true))
+    {
+        bool braced = *s == '{';
+        const char *name = s + braced;
+        const char *end = name;
+        while (is_name_char(*end, end == name))
+        {
+            end++;
+        }
+        if (braced && (*end != '}' || end == name))
+        {
+            fprintf(stderr, "Error: Bad substitution.\n");
+            return -1;
+        }
+        // getenv() wants the name on its own; names are short, so a local
+        // copy keeps this allocation-free
+        char buffer[256];
+        size_t len = (size_t)(end - name);
+        if (len < sizeof(buffer))
+        {
+            memcpy(buffer, name, len);
+            buffer[len] = '\0';
+            value = getenv(buffer);
+        }
+        s = end + braced;
+    }
+    else
+    {
+        *p = s;
+        return arena_putc(&lexer->arena, '$');
+    }
+
+    *p = s;
+    return value ? put_quoted_string(lexer, value, escaped) : 0;
+}
+
+// Expands a ~ or ~user at the start of an unquoted word, advancing *p.
+// Anything else (or an unknown user) is left as it is.
+static int expand_tilde(struct lexer *lexer, const char **p, bool *escaped)
+{
+    const char *name = *p + 1;
+    const char *end = name;
+    while (*end && *end != '/' && *end != ' ' && *end != '\t' && !strchr("|<>;&'\"\\$", *end))
+    {
+        end++;
+    }
+
+    const char *home = NULL;
+    if (end == name)
+    {
+        home = getenv("HOME");
+        struct passwd *pw = home ? NULL : getpwuid(getuid());
+        home = home ? home : pw ? pw->pw_dir : NULL;
+    }
+    else
+    {
+        char buffer[256];
+        size_t len = (size_t)(end - name);
+        if (len < sizeof(buffer))
+        {
+            memcpy(buffer, name, len);
+            buffer[len] = '\0';
+            struct passwd *pw = getpwnam(buffer);
+            home = pw ? pw->pw_dir : NULL;
+        }
+    }
+    if (!home)
+    {
+        return 0; // The ~ is copied as an ordinary character
+    }
+    *p = end;
+    return put_quoted_string(lexer, home, escaped);
+}
+
+int line_splitter(struct lexer *lexer, const char **line, enum list_op *list_op)
+{
+    arena_reset(&lexer->arena);
+    int argc = 0;
+    const char *p = *line;
+    int length;
+    char *op;
+
+    *list_op = LIST_END;
+
+    for (;;)
     {
         // Skip leading whitespace
-        while (*token == ' ' || *token == '\t')
+        while (*p == ' ' || *p == '\t')
         {
-            token++;
+            p++;
         }
-        if (*token == '\0')
+        if (*p == '\0' || *p == '#')
         {
-            break; // End of line
+            p += strlen(p);
+            break; // End of line, or a comment (which covers a #! line)
         }
 
-        // Handling quoted strings
-        if (*token == '"')
+        // Operators stand alone; ;, &, && and || end the pipeline
+        if ((op = match_operator(p, &length)) != NULL)
         {
-            token++;              // Skip the opening quote
-            argv[argc++] = token; // Store the start of the token
+            p += length;
+            if ((*list_op = list_operator(op)) != LIST_END)
+            {
+                break;
+            }
+            if (add_word(lexer, argc++, op) == -1)
+            {
+                return -1;
+            }
+            continue;
+        }
 
-            while (*token && *token != '"')
+        // One word, up to unquoted whitespace, an operator or the end
+        bool quoted = false;  // Any quotes, so an empty result is still a word
+        bool escaped = false; // Quoted glob characters were escaped
+        bool magic = false;   // An unquoted *, ? or [: the word is a pattern
+        if (*p == '~' && expand_tilde(lexer, &p, &escaped) == -1)
+        {
+            return -1;
+        }
+        while (*p && *p != ' ' && *p != '\t' && !match_operator(p, &length))
+        {
+            int err = 0;
+            if (*p == '\'')
+            {
+                // Everything up to the next ' is literal
+                const char *close = strchr(p + 1, '\'');
+                if (!close)
+                {
+                    fprintf(stderr, "Error: Mismatched quotes in input.\n");
+                    return -1;
+                }
+                for (p++; p < close && !err; p++)
+                {
+                    err = put_quoted(lexer, *p, &escaped);
+                }
+                p = close + 1;
+                quoted = true;
+            }
+            else if (*p == '"')
+            {
+                // $ expands and \ escapes only $ " \ and `
+                for (p++; *p && *p != '"' && !err;)
+                {
+                    if (*p == '\\' && p[1] && strchr("$\"\\`", p[1]))
+                    {
+                        err = put_quoted(lexer, p[1], &escaped);
+                        p += 2;
+                    }
+                    else if (*p == '$')
+                    {
+                        err = expand_dollar(lexer, &p, &escaped);
+                    }
+                    else
+                    {
+                        err = put_quoted(lexer, *p++, &escaped);
+                    }
+                }
+                if (*p != '"')
+                {
+                    fprintf(stderr, "Error: Mismatched quotes in input.\n");
+                    return -1;
+                }
+                p++;
+                quoted = true;
+            }
+            else if (*p == '\\')
             {
-                token++; // Move to the next character
+                // A backslash keeps the next character literal, even an operator
+                if (p[1])
+                {
+                    p++;
+                }
+                err = put_quoted(lexer, *p++, &escaped);
+                quoted = true;
             }
-            //
-            //
-            if (*token == '"')
+            else if (*p == '$')
             {
-                *token = '\0'; // Null-terminate the quoted argument
-                token++;       // Move past the closing quote
+                err = expand_dollar(lexer, &p, &escaped);
             }
             else
+            {
+                magic = magic || *p == '*' || *p == '?' || *p == '[';
+                err = arena_putc(&lexer->arena, *p++);
+            }
+            if (err)
+            {
+                return -1;
+            }
+        }
+
+        // An unquoted expansion that came out empty leaves no word at all
+        if (arena_length(&lexer->arena) == 0 && !quoted)
+        {
+            continue;
+        }
+        char *word = arena_finish(&lexer->arena);
+        if (!word)
+        {
+            return -1;
+        }
+
+        // A pattern becomes the paths it matches, sorted; one that matches
+        // nothing stays as it is, as in sh
+        if (magic)
+        {
+            struct glob_words words = {lexer, argc};
+            int matches = glob_expand(word, &lexer->arena, add_match, &words);
+            if (matches == -1)
+            {
+                return -1;
+            }
+            if (matches > 0)
+            {
+                qsort(lexer->argv + argc, (size_t)matches, sizeof(char *), compare_words);
+                argc += matches;
+                continue;
+            }
+        }
+        if (magic || escaped)
+        {
+            glob_unescape(word);
+        }
+        if (add_word(lexer, argc++, word) == -1)
+        {
+            return -1;
+        }
+    }
+
+    *line = p;
+    if (add_word(lexer, argc, NULL) == -1) // exec requires a NULL-terminated array of strings
+    {
+        return -1;
+    }
+    return argc; // Return the number of arguments
+}
+
+void lexer_free(struct lexer *lexer)
+{
+    arena_free(&lexer->arena);
+    free(lexer->argv);
+    lexer->argv = NULL;
+    lexer->cap = 0;
+}
+
+// Appends a pipeline to the list, growing it only past its largest size
+static int add_item(struct line_list *list, const char *start, enum list_op op)
+{
+    if (list->count == list->cap)
+    {
+        size_t cap = list->cap ? list->cap * 2 : 16;
+        struct list_item *items = realloc(list->items, cap * sizeof(*items));
+        if (!items)
+        {
+            fprintf(stderr, "Error: realloc() failed. %s.\n", strerror(errno));
+            return -1;
+        }
+        list->items = items;
+        list->cap = cap;
+    }
+    list->items[list->count].start = start;
+    list->items[list->count].op = op;
+    list->count++;
+    return 0;
+}
+
+// Moves *p past one word, quotes and backslashes included, ending where
+// line_splitter() would end it. Returns -1 on an unclosed quote (an error
+// has been printed).
+static int skip_word(const char **p)
+{
+    const char *s = *p;
+    int length;
+    while (*s && *s != ' ' && *s != '\t' && !match_operator(s, &length))
+    {
+        if (*s == '\'' || *s == '"')
+        {
+            char quote = *s++;
+            while (*s && *s != quote)
+            {
+                s += quote == '"' && *s == '\\' && s[1] ? 2 : 1;
+            }
+            if (!*s)
             {
                 fprintf(stderr, "Error: Mismatched quotes in input.\n");
-                return -1; // Error: Mismatched quotes
+                return -1;
             }
         }
-        else
+        else if (*s == '\\' && s[1])
         {
-            // Handle unquoted strings
-            argv[argc++] = token;
+            s++;
+        }
+        s++;
+    }
+    *p = s;
+    return 0;
+}
+
+int parse_list(const char *line, struct line_list *list)
+{
+    list->count = 0;
+    const char *p = line;
+    const char *start = line;      // Text of the pipeline being read
+    enum list_op last = LIST_SEQ;  // Operator before it
+    int words = 0;                 // Words of its current command, file names left out
+    bool piped = false;            // The current command comes after a |
+    const char *redirect = NULL;   // A <, > or >> still waiting for its file name
+    int length;
+    char *op;
 
-            // Find the next space or end of input
-            while (*token && *token != ' ' && *token != '\t')
+    for (;;)
+    {
+        while (*p == ' ' || *p == '\t')
+        {
+            p++;
+        }
+        if (*p == '\0' || *p == '#')
+        {
+            break; // End of line, or a comment
+        }
+        if ((op = match_operator(p, &length)) == NULL)
+        {
+            if (skip_word(&p) == -1)
             {
-                token++;
+                return -1;
             }
+            words += redirect == NULL;
+            redirect = NULL;
+            continue;
         }
 
-        // Null-terminate the current argument
-        if (*token)
+        if (redirect)
         {
-            *token = '\0';
-            token++;
+            fprintf(stderr, "Error: Missing file name after '%s'.\n", redirect);
+            return -1;
+        }
+        enum list_op list_op = list_operator(op);
+        if ((op == op_pipe || list_op != LIST_END) && words == 0)
+        {
+            if (piped)
+            {
+                fprintf(stderr, "Error: Missing command after '|'.\n");
+            }
+            else
+            {
+                fprintf(stderr, "Error: Missing command before '%s'.\n", op);
+            }
+            return -1;
+        }
+        p += length;
+        if (op == op_pipe)
+        {
+            piped = true;
+            words = 0;
+        }
+        else if (list_op != LIST_END)
+        {
+            if (add_item(list, start, list_op) == -1)
+            {
+                return -1;
+            }
+            start = p;
+            last = list_op;
+            piped = false;
+            words = 0;
+        }
+        else
+        {
+            redirect = op;
         }
     }
 
-    if (argc >= max - 1)
+    if (redirect)
+    {
+        fprintf(stderr, "Error: Missing file name after '%s'.\n", redirect);
+        return -1;
+    }
+    if (words > 0)
+    {
+        return add_item(list, start, LIST_END);
+    }
+    // Only the end of the line may be empty, and not after &&, || or |
+    if (piped || last == LIST_AND || last == LIST_OR)
     {
-        fprintf(stderr, "Error: Too many arguments.\n");
-        return -1; // Error: Argument limit exceeded
+        fprintf(stderr, "Error: Missing command after '%s'.\n", piped ? "|" : last == LIST_AND ? "&&" : "||");
+        return -1;
     }
+    return 0;
+}
+
+void line_list_free(struct line_list *list)
+{
+    free(list->items);
+    list->items = NULL;
+    list->count = 0;
+    list->cap = 0;
+}
 
-    argv[argc] = NULL; // exec requires a NULL-terminated array of strings
-    return argc;       // Return the number of arguments
+int parse_pipeline(char **argv, int argc, struct pipeline *pl)
+{
+    memset(pl, 0, sizeof(*pl));
+    struct command *cmd = &pl->stages[0];
+    cmd->argv = argv;
+    pl->count = 1;
+
+    int out = 0; // Next free slot of argv; never ahead of i
+    for (int i = 0; i < argc; i++)
+    {
+        char *token = argv[i];
+        if (token == op_pipe)
+        {
+            if (cmd->argc == 0)
+            {
+                fprintf(stderr, "Error: Missing command before '|'.\n");
+                return -1;
+            }
+            if (pl->count == MAX_PIPE)
+            {
+                fprintf(stderr, "Error: Too many commands in pipeline.\n");
+                return -1;
+            }
+            argv[out++] = NULL; // Ends this command's argv
+            cmd = &pl->stages[pl->count++];
+            cmd->argv = &argv[out];
+        }
+        else if (is_operator(token))
+        {
+            if (i + 1 == argc || is_operator(argv[i + 1]))
+            {
+                fprintf(stderr, "Error: Missing file name after '%s'.\n", token);
+                return -1;
+            }
+            if (token == op_input)
+            {
+                cmd->input = argv[++i];
+            }
+            else
+            {
+                cmd->output = argv[++i];
+                cmd->append = token == op_append;
+            }
+        }
+        else
+        {
+            argv[out++] = token;
+            cmd->argc++;
+        }
+    }
+    argv[out] = NULL;
+
+    if (cmd->argc == 0)
+    {
+        fprintf(stderr, pl->count > 1 ? "Error: Missing command after '|'.\n" : "Error: Missing command.\n");
+        return -1;
+    }
+    return 0;
 }
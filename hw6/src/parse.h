@@ -1,6 +1,98 @@
 #ifndef PARSE_H
 #define PARSE_H
 
-int line_splitter(char *line, char **argv, int max);
+#include <stddef.h> // For size_t
+#include "arena.h"
+
+#define MAX_PIPE 64 // Most commands in one pipeline
+
+// One command of a pipeline. argv points into the token array given to
+// parse_pipeline() and is NULL-terminated.
+struct command
+{
+    char **argv;
+    int argc;
+    const char *input;  // < file, or NULL
+    const char *output; // > or >> file, or NULL
+    int append;         // output was given with >>
+};
+
+struct pipeline
+{
+    struct command stages[MAX_PIPE];
+    int count;
+};
+
+// How a pipeline is joined to the one after it on a line
+enum list_op
+{
+    LIST_END,        // Last one
+    LIST_SEQ,        // ;  run the next one regardless
+    LIST_AND,        // && run the next one if this one succeeded
+    LIST_OR,         // || run the next one if this one failed
+    LIST_BACKGROUND, // &  run this one in the background and go on
+};
+
+// Words of the line being run. The words live in the arena and argv is
+// grown only when a line has more words than any before, so both are
+// reused from line to line.
+struct lexer
+{
+    struct arena arena;
+    char **argv;
+    size_t cap;
+};
+
+// The pipelines of a line, found before any of it runs. Each is the text
+// from start up to its operator op, for line_splitter() to lex when it is
+// its turn. The array is reused from line to line, as the lexer's is.
+struct list_item
+{
+    const char *start;
+    enum list_op op;
+};
+
+struct line_list
+{
+    struct list_item *items;
+    size_t count;
+    size_t cap;
+};
+
+// Splits a whole line into its pipelines, checking its syntax (quotes,
+// and a command and file name wherever one is needed) without expanding
+// anything. Returns 0, or -1 if any of the line is invalid (an error has
+// been printed), so that a bad line runs none of its pipelines.
+int parse_list(const char *line, struct line_list *list);
+
+void line_list_free(struct line_list *list);
+
+// Splits the next pipeline of *line into lexer->argv (NULL-terminated), in
+// a single pass:
+// - 'single quotes' keep everything; "double quotes" expand $, and a
+//   backslash in them escapes only $, ", ` and backslash
+// - a backslash outside quotes keeps the next character literal
+// - $NAME, ${NAME}, $? and $$ are expanded (without field splitting);
+//   an unquoted word that expands to nothing is dropped
+// - ~ and ~user at the start of a word become the home directory
+// - a word with an unquoted *, ? or [ is replaced by the sorted paths it
+//   matches (see glob.h), unless it matches none
+// - unquoted |, <, > and >> are words of their own even without
+//   surrounding spaces, and an unquoted # starts a comment
+// The pipeline ends at an unquoted ;, &, && or || (stored in *op, with
+// *line moved past it) or at the end of the line (LIST_END). Lexing one
+// pipeline at a time means $? is expanded after the ones before it ran.
+// Operators are returned as pointers to shared operator strings, so a
+// quoted "|" stays a plain argument. Returns the number of words, or -1
+// (an error has been printed). The words last until the next call.
+int line_splitter(struct lexer *lexer, const char **line, enum list_op *op);
+
+void lexer_free(struct lexer *lexer);
+
+// Groups the tokens from line_splitter() into the commands of a pipeline,
+// taking out the operators and redirections (argv is rearranged in place).
+// Returns 0, or -1 if the line is not a valid pipeline (an error has been
+// printed).
+int parse_pipeline(char **argv, int argc, struct pipeline *pl);
 
 #endif
@@ -0,0 +1,205 @@
+#define _POSIX_C_SOURCE 200809L
+#include "minishell.h"
+#include <sys/stat.h> // For stat
+#include "pathcache.h"
+
+#define PATH_BUCKETS 256 // Chains of the name -> path table
+
+struct cached
+{
+    char *name;
+    char *path;
+    unsigned hits;
+    struct cached *next;
+};
+
+static struct cached *buckets[PATH_BUCKETS];
+static char *cached_for; // Value of PATH the cache was filled with
+
+// FNV-1a
+static unsigned bucket_of(const char *name)
+{
+    unsigned h = 2166136261u;
+    for (; *name; name++)
+    {
+        h = (h ^ (unsigned char)*name) * 16777619u;
+    }
+    return h % PATH_BUCKETS;
+}
+
+static void clear_cache(void)
+{
+    for (int b = 0; b < PATH_BUCKETS; b++)
+    {
+        while (buckets[b])
+        {
+            struct cached *entry = buckets[b];
+            buckets[b] = entry->next;
+            free(entry->name);
+            free(entry->path);
+            free(entry);
+        }
+    }
+    free(cached_for);
+    cached_for = NULL;
+}
+
+// Searches PATH for name. Returns a malloc()ed path, or NULL.
+static char *search_path(const char *name, const char *path_var)
+{
+    size_t name_len = strlen(name);
+    const char *dir = path_var;
+    for (;;)
+    {
+        const char *end = strchr(dir, ':');
+        size_t dir_len = end ? (size_t)(end - dir) : strlen(dir);
+        // An empty entry means the current directory
+        char *candidate = malloc(dir_len + name_len + 3);
+        if (!candidate)
+        {
+            fprintf(stderr, "Error: malloc() failed. %s.\n", strerror(errno));
+            return NULL;
+        }
+        if (dir_len == 0)
+        {
+            memcpy(candidate, "./", 2);
+            dir_len = 1;
+        }
+        else
+        {
+            memcpy(candidate, dir, dir_len);
+            candidate[dir_len] = '/';
+        }
+        memcpy(candidate + dir_len + 1, name, name_len + 1);
+
+        struct stat st;
+        if (stat(candidate, &st) == 0 && S_ISREG(st.st_mode) && access(candidate, X_OK) == 0)
+        {
+            return candidate;
+        }
+        free(candidate);
+        if (!end)
+        {
+            return NULL;
+        }
+        dir = end + 1;
+    }
+}
+
+// Finds name's entry, filling it in from PATH if needed; NULL if not found
+static struct cached *lookup(const char *name)
+{
+    const char *path_var = getenv("PATH");
+    if (!path_var)
+    {
+        path_var = "/usr/bin:/bin"; // What execvp() falls back to
+    }
+    if (cached_for && strcmp(cached_for, path_var) != 0)
+    {
+        clear_cache(); // PATH changed, so every entry may be stale
+    }
+    if (!cached_for && !(cached_for = strdup(path_var)))
+    {
+        fprintf(stderr, "Error: strdup() failed. %s.\n", strerror(errno));
+        return NULL;
+    }
+
+    unsigned b = bucket_of(name);
+    for (struct cached *entry = buckets[b]; entry; entry = entry->next)
+    {
+        if (strcmp(entry->name, name) == 0)
+        {
+            return entry;
+        }
+    }
+
+    char *path = search_path(name, path_var);
+    if (!path)
+    {
+        return NULL;
+    }
+    struct cached *entry = malloc(sizeof(*entry));
+    if (!entry || !(entry->name = strdup(name)))
+    {
+        fprintf(stderr, "Error: malloc() failed. %s.\n", strerror(errno));
+        free(entry);
+        free(path);
+        return NULL;
+    }
+    entry->path = path;
+    entry->hits = 0;
+    entry->next = buckets[b];
+    buckets[b] = entry;
+    return entry;
+}
+
+const char *path_lookup(const char *name)
+{
+    if (strchr(name, '/'))
+    {
+        return name;
+    }
+    struct cached *entry = lookup(name);
+    if (!entry)
+    {
+        return NULL;
+    }
+    entry->hits++;
+    return entry->path;
+}
+
+void path_forget(const char *name)
+{
+    for (struct cached **link = &buckets[bucket_of(name)]; *link; link = &(*link)->next)
+    {
+        struct cached *entry = *link;
+        if (strcmp(entry->name, name) == 0)
+        {
+            *link = entry->next;
+            free(entry->name);
+            free(entry->path);
+            free(entry);
+            return;
+        }
+    }
+}
+
+int builtin_hash(int argc, char **argv)
+{
+    if (argc == 1)
+    {
+        int empty = 1;
+        for (int b = 0; b < PATH_BUCKETS; b++)
+        {
+            for (struct cached *entry = buckets[b]; entry; entry = entry->next)
+            {
+                if (empty)
+                {
+                    printf("hits\tcommand\n");
+                    empty = 0;
+                }
+                printf("%4u\t%s\n", entry->hits, entry->path);
+            }
+        }
+        if (empty)
+        {
+            printf("hash: hash table empty\n");
+        }
+        return EXIT_SUCCESS;
+    }
+
+    int status = EXIT_SUCCESS;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-r") == 0)
+        {
+            clear_cache();
+        }
+        else if (strchr(argv[i], '/') == NULL && lookup(argv[i]) == NULL)
+        {
+            fprintf(stderr, "Error: hash: %s: not found.\n", argv[i]);
+            status = EXIT_FAILURE;
+        }
+    }
+    return status;
+}
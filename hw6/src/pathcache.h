@@ -0,0 +1,20 @@
+#ifndef PATHCACHE_H
+#define PATHCACHE_H
+
+// Command name -> absolute path cache, so PATH is searched once per
+// command name instead of by execvp() on every run. The cache is dropped
+// whenever PATH changes.
+
+// Returns the path to run for name: name itself if it contains a '/',
+// otherwise the first executable regular file called name in PATH.
+// NULL if there is none. The string stays valid until the cache changes.
+const char *path_lookup(const char *name);
+
+// Drops name from the cache, e.g. after its cached path failed to run
+void path_forget(const char *name);
+
+// hash [-r] [name...]: without arguments lists the cache (hits and path),
+// -r empties it, names are looked up and added
+int builtin_hash(int argc, char **argv);
+
+#endif
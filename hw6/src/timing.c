@@ -0,0 +1,156 @@
+#define _POSIX_C_SOURCE 200809L
+#include "minishell.h"
+#include <ctype.h> // For isdigit
+#include <time.h>  // For clock_gettime
+#include "timing.h"
+
+// Pipeline totals: times and counts add up, max RSS is the largest
+struct totals
+{
+    double real, user, sys;
+    long maxrss;
+    long nvcsw, nivcsw, majflt, minflt;
+};
+
+double timing_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+void timing_start(struct timing *timing, int count)
+{
+    memset(timing, 0, sizeof(*timing));
+    timing->count = count;
+    timing->start = timing_now();
+}
+
+static double seconds(struct timeval tv)
+{
+    return (double)tv.tv_sec + (double)tv.tv_usec / 1e6;
+}
+
+static struct totals add_up(const struct timing *timing)
+{
+    struct totals t = {.real = timing->end - timing->start};
+    for (int i = 0; i < timing->count; i++)
+    {
+        const struct rusage *ru = &timing->usage[i];
+        if (!timing->measured[i])
+        {
+            continue;
+        }
+        t.user += seconds(ru->ru_utime);
+        t.sys += seconds(ru->ru_stime);
+        t.maxrss = ru->ru_maxrss > t.maxrss ? ru->ru_maxrss : t.maxrss;
+        t.nvcsw += ru->ru_nvcsw;
+        t.nivcsw += ru->ru_nivcsw;
+        t.majflt += ru->ru_majflt;
+        t.minflt += ru->ru_minflt;
+    }
+    return t;
+}
+
+// Prints TIMEFORMAT with its % sequences filled in
+static void print_format(const char *format, const struct totals *t)
+{
+    for (const char *f = format; *f; f++)
+    {
+        if (*f != '%' || !f[1])
+        {
+            fputc(*f, stderr);
+            continue;
+        }
+        f++;
+        int precision = 3;
+        if (isdigit((unsigned char)*f))
+        {
+            precision = *f - '0' > 6 ? 6 : *f - '0';
+            f++;
+        }
+        switch (*f)
+        {
+        case 'R':
+            fprintf(stderr, "%.*f", precision, t->real);
+            break;
+        case 'U':
+            fprintf(stderr, "%.*f", precision, t->user);
+            break;
+        case 'S':
+            fprintf(stderr, "%.*f", precision, t->sys);
+            break;
+        case 'P':
+            fprintf(stderr, "%.*f", precision > 2 ? 2 : precision,
+                    t->real > 0 ? (t->user + t->sys) * 100 / t->real : 0.0);
+            break;
+        case 'M':
+            fprintf(stderr, "%ld", t->maxrss);
+            break;
+        case 'w':
+            fprintf(stderr, "%ld", t->nvcsw);
+            break;
+        case 'c':
+            fprintf(stderr, "%ld", t->nivcsw);
+            break;
+        case 'F':
+            fprintf(stderr, "%ld", t->majflt);
+            break;
+        case 'f':
+            fprintf(stderr, "%ld", t->minflt);
+            break;
+        case '%':
+            fputc('%', stderr);
+            break;
+        case '\0':
+            f--; // A lone % at the end
+            fputc('%', stderr);
+            break;
+        default:
+            fprintf(stderr, "%%%c", *f); // Unknown; printed as it is
+            break;
+        }
+    }
+    fputc('\n', stderr);
+}
+
+void timing_report(const struct timing *timing, const struct pipeline *pl, bool posix)
+{
+    struct totals t = add_up(timing);
+    if (posix)
+    {
+        fprintf(stderr, "real %.2f\nuser %.2f\nsys %.2f\n", t.real, t.user, t.sys);
+        return;
+    }
+    const char *format = getenv("TIMEFORMAT");
+    if (format && *format)
+    {
+        print_format(format, &t);
+        return;
+    }
+
+    fprintf(stderr, "\nreal    %.3fs\nuser    %.3fs\nsys     %.3fs\n", t.real, t.user, t.sys);
+    fprintf(stderr, "maxrss  %ld KiB\n", t.maxrss);
+    fprintf(stderr, "ctxsw   %ld voluntary, %ld involuntary\n", t.nvcsw, t.nivcsw);
+    fprintf(stderr, "faults  %ld major, %ld minor\n", t.majflt, t.minflt);
+    if (timing->count < 2)
+    {
+        return;
+    }
+
+    fprintf(stderr, "\n%-5s %10s %8s %8s %10s %6s %6s %6s %8s  %s\n", "stage", "spawn(us)", "user", "sys",
+            "maxrss(K)", "vcsw", "ivcsw", "majflt", "minflt", "command");
+    for (int i = 0; i < timing->count; i++)
+    {
+        const struct rusage *ru = &timing->usage[i];
+        if (!timing->measured[i])
+        {
+            fprintf(stderr, "%-5d %10s %8s %8s %10s %6s %6s %6s %8s  %s\n", i, "-", "-", "-", "-", "-", "-", "-",
+                    "-", pl->stages[i].argv[0]);
+            continue;
+        }
+        fprintf(stderr, "%-5d %10.0f %8.3f %8.3f %10ld %6ld %6ld %6ld %8ld  %s\n", i, timing->spawn[i] * 1e6,
+                seconds(ru->ru_utime), seconds(ru->ru_stime), ru->ru_maxrss, ru->ru_nvcsw, ru->ru_nivcsw,
+                ru->ru_majflt, ru->ru_minflt, pl->stages[i].argv[0]);
+    }
+}
@@ -0,0 +1,36 @@
+#ifndef TIMING_H
+#define TIMING_H
+
+#include <stdbool.h>      // For bool
+#include <sys/resource.h> // For struct rusage
+#include "parse.h"
+
+// What 'time pipeline' measures: the wall time of the whole pipeline, and
+// for each command the wait4() resource usage and how long it took to
+// start. posix_spawn() returns once the child has called exec, so the
+// start time of a program runs until its exec succeeded.
+struct timing
+{
+    double start;                  // Monotonic clock when the pipeline began
+    double end;                    // ... and when its last command was reaped
+    double spawn[MAX_PIPE];        // Seconds to start each command
+    struct rusage usage[MAX_PIPE]; // From wait4(), or getrusage() for an in-shell builtin
+    bool measured[MAX_PIPE];       // usage is filled in
+    bool stopped;                  // Stopped (^Z) before it finished: nothing to report
+    int count;
+};
+
+// Monotonic clock in seconds
+double timing_now(void);
+
+void timing_start(struct timing *timing, int count);
+
+// Prints the report to stderr. With posix it is the 'time -p' format;
+// otherwise, if TIMEFORMAT is set, that format is used for the totals:
+//   %R real, %U user, %S system seconds (%3R: 3 decimals, the default),
+//   %P CPU percentage, %M max RSS in KiB, %w voluntary and %c involuntary
+//   context switches, %F major and %f minor page faults, %% a percent
+// Else a readable summary, with one row per command for a pipeline.
+void timing_report(const struct timing *timing, const struct pipeline *pl, bool posix);
+
+#endif